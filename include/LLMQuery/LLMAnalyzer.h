@@ -7,14 +7,42 @@
 
 #include "Utils/Tool/Http.h"
 #include "Utils/Tool/Common.h"
+#include "LLMQuery/LLMResponseCache.h"
+#include "LLMQuery/LLMExecutor.h"
+#include "LLMQuery/LLMRateLimiter.h"
+#include <atomic>
+#include <memory>
+#include <mutex>
 #include <tuple>
 #include <utility>
 
 using namespace std;
+
+// token用量，同一次classify的多个投票并发累加，缓存命中不计
+typedef struct LLMUsage {
+    atomic<unsigned> inputTokens{0};
+    atomic<unsigned> outputTokens{0};
+} LLMUsage;
+
+// 一次classify的结构化结果，供日志记录
+typedef struct ClassifyRecord {
+    bool answer = false;
+    unsigned yesVotes = 0;
+    unsigned noVotes = 0;
+    unsigned skippedVotes = 0;
+    // responses of counted votes, summarizing included
+    vector<string> responses;
+    double latencyMs = 0;
+    // tokens of the votes finished before the answer was decided
+    unsigned inputTokens = 0;
+    unsigned outputTokens = 0;
+} ClassifyRecord;
+
 // interact with LLM by curl
 
 class LLMAnalyzer {
 public:
+    string models_url;
     string query_url;
     string model;
     float temperature;
@@ -22,27 +50,59 @@ public:
     long totalLLMTime = 0;
     unsigned totalInputTokenNum = 0;
     unsigned totalOutputTokenNum = 0;
+    // votes not needed because the majority was already decided
+    unsigned totalSkippedVoteNum = 0;
     unsigned retry;
     unsigned voteTime;
+    // 响应缓存，为空时每次都查询LLM
+    LLMResponseCache* cache = nullptr;
+
+    // 通过n参数在一次请求中获取全部投票样本
+    bool multiSample = false;
+    // 服务器拒绝或忽略n参数后，之后的投票回退为单独请求
+    atomic<bool> multiSampleRejected{false};
+    // 返回了多个样本的请求数
+    unsigned totalMultiSampleQueryNum = 0;
+
+    // 请求速率与token预算，失败重试的退避
+    LLMRateLimiter limiter;
+
+    // 所有classify共享的请求执行器，worker数即同时进行的LLM请求上限
+    unique_ptr<LLMExecutor> executor;
 
-    explicit LLMAnalyzer(const string& addr, float _temparature = -1, unsigned _retry = 3, unsigned _vote = 5, string _logDir = ""):
-        temperature(_temparature), retry(_retry), voteTime(_vote) {
+    explicit LLMAnalyzer(const string& addr, float _temparature = -1, unsigned _retry = 3, unsigned _vote = 5, string _logDir = "",
+                         unsigned _concurrency = 16):
+        temperature(_temparature), retry(_retry), voteTime(_vote), executor(make_unique<LLMExecutor>(_concurrency)) {
         string base_url = "http://" + addr + "/v1";
-        string check_model_url = base_url + "/models";
+        models_url = base_url + "/models";
         query_url = base_url + "/chat/completions";
-
-        json models;
-        if (!httpGet(base_url + "/models", models)) {
-            OP << "unable to get model information\n";
-            exit(1);
-        }
-        model = models["data"][0]["id"];
-        OP << "model is: " << model << "\n";
     }
 
-    string queryLLM(string& SysPrompt, string& UserPrompt, vector<string>& curLogs);
+    // 从/v1/models获取模型名，服务器可能仍在启动，失败后退避重试，共尝试attempts次
+    // 查询LLM前必须成功调用
+    bool fetchModel(unsigned attempts = 3);
+
+    // voteIdx区分同一prompt的多次投票，作为缓存key的一部分
+    // cancelled被置为true后不再重试，进行中的请求被中止，usage非空时累加本次token用量
+    string queryLLM(string& SysPrompt, string& UserPrompt, vector<string>& curLogs, unsigned voteIdx = 0,
+                    const atomic<bool>* cancelled = nullptr, LLMUsage* usage = nullptr);
+
+    // 从缓存中取投票[0, n)的样本，以(voteIdx, content, log)追加到samples，未命中的投票追加到missing
+    void lookupSamples(string& SysPrompt, string& UserPrompt, unsigned n, vector<tuple<unsigned, string, string>>& samples,
+                       vector<unsigned>& missing);
+
+    // 一次请求获取voteIdxs中各投票的样本，以(voteIdx, content, log)追加到samples，返回false表示有投票未得到样本
+    bool querySamples(string& SysPrompt, string& UserPrompt, const vector<unsigned>& voteIdxs,
+                      vector<tuple<unsigned, string, string>>& samples, const atomic<bool>* cancelled = nullptr,
+                      LLMUsage* usage = nullptr);
+
+    // majority voting, stops as soon as the remaining votes can not change the answer
+    // record非空时写入投票、响应、耗时与token用量
+    bool classify(string& SysPrompt, string& UserPrompt, string SummarizingTemplate, vector<string>& curLogs,
+                  ClassifyRecord* record = nullptr);
 
-    bool classify(string& SysPrompt, string& UserPrompt, string SummarizingTemplate, vector<string>& curLogs);
+    // wait until queued and cancelled votes of earlier classify calls finished, call before exit
+    void waitForVotes();
 };
 
 #endif //WRAPPERDETECT_LLMANALYZER_H
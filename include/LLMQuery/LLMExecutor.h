@@ -0,0 +1,60 @@
+//
+// Created on 2026/10/19.
+//
+
+#ifndef WRAPPERDETECT_LLMEXECUTOR_H
+#define WRAPPERDETECT_LLMEXECUTOR_H
+
+#include <condition_variable>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+// 会话内共享的LLM请求执行器，固定数量的worker按提交顺序执行请求任务
+// worker数即同时进行的LLM请求上限，避免每次投票创建线程
+class LLMExecutor {
+private:
+    struct Job {
+        function<void()> fn;
+        chrono::steady_clock::time_point submitTime;
+    };
+
+    vector<thread> workers;
+    deque<Job> queue;
+    // 正在执行的任务数
+    unsigned running = 0;
+    bool stopping = false;
+    mutex queueMutex;
+    condition_variable queueCV;
+    condition_variable idleCV;
+
+    void workerLoop();
+
+public:
+    // 统计信息，读取时需持有queueMutex或在waitIdle之后
+    unsigned totalJobNum = 0;
+    size_t maxQueueDepth = 0;
+    double totalQueueWaitMs = 0;
+
+    explicit LLMExecutor(unsigned concurrency);
+
+    // 等待已提交的任务全部完成后结束worker
+    ~LLMExecutor();
+
+    unsigned getConcurrency() const { return workers.size(); }
+
+    void submit(function<void()> fn);
+
+    // 当前排队(尚未开始)的任务数
+    size_t getQueueDepth();
+
+    // 等待队列清空且没有任务在执行
+    void waitIdle();
+};
+
+#endif //WRAPPERDETECT_LLMEXECUTOR_H
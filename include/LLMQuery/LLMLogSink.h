@@ -0,0 +1,64 @@
+//
+// Created on 2026/10/19.
+//
+
+#ifndef WRAPPERDETECT_LLMLOGSINK_H
+#define WRAPPERDETECT_LLMLOGSINK_H
+
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <thread>
+
+#include "Utils/Tool/Http.h"
+
+// LLM分析日志的异步写出，所有记录以JSONL追加到目录下的llm_log.jsonl(压缩时为llm_log.jsonl.zst)
+// emit只把记录放入队列，由后台线程批量序列化写出，不阻塞分析线程
+// 文件超过maxBytes时轮转为llm_log.<n>.jsonl[.zst]，n递增；压缩时每批写出后flush，已写出的部分可随时解压
+class LLMLogSink {
+private:
+    string dir;
+    string activePath;
+    bool compress = false;
+    uint64_t maxBytes = 0;
+    ofstream out;
+    uint64_t fileBytes = 0;
+    unsigned rotationNum = 0;
+    // ZSTD_CCtx*，未启用zstd时为空
+    void* zstdCtx = nullptr;
+
+    deque<json> queue;
+    bool stopping = false;
+    mutex queueMutex;
+    condition_variable queueCV;
+    thread writer;
+
+    bool openFile();
+    void closeFile();
+    void rotate();
+    // endFrame为true时结束当前zstd frame
+    void writeData(const string& data, bool endFrame = false);
+    void writerLoop();
+
+public:
+    unsigned recordNum = 0;
+    size_t maxQueueDepth = 0;
+
+    ~LLMLogSink() { close(); }
+
+    // 编译时是否找到了zstd
+    static bool hasZstd();
+
+    // 创建目录并以追加方式打开日志，maxBytes为0时不轮转
+    bool open(const string& _dir, bool _compress = false, uint64_t _maxBytes = 0);
+
+    bool isOpen() const { return writer.joinable(); }
+
+    void emit(json record);
+
+    // 写出队列中剩余的记录并关闭文件
+    void close();
+};
+
+#endif //WRAPPERDETECT_LLMLOGSINK_H
@@ -0,0 +1,63 @@
+//
+// Created on 2026/10/19.
+//
+
+#ifndef WRAPPERDETECT_LLMRATELIMITER_H
+#define WRAPPERDETECT_LLMRATELIMITER_H
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <random>
+
+using namespace std;
+
+// LLM请求的全局调度: requests/sec与tokens/min两个令牌桶，服务器Retry-After时全局暂停，失败重试按指数退避加抖动
+// 速率为0表示不限制，所有等待都可被cancelled中止，并计入限流耗时统计
+class LLMRateLimiter {
+private:
+    typedef chrono::steady_clock Clock;
+
+    mutex limiterMutex;
+    Clock::time_point lastRefill = Clock::now();
+    // 令牌桶余量，token桶可因实际用量超出预估而为负
+    double requestBucket = 1;
+    double tokenBucket = 0;
+    // Retry-After要求的全局暂停截止时间
+    Clock::time_point pausedUntil;
+    mt19937 rng{random_device{}()};
+
+    void refill(Clock::time_point now);
+
+    // 分段睡眠以便响应cancelled，返回false表示被取消
+    static bool sleepFor(double ms, const atomic<bool>* cancelled);
+
+public:
+    double requestsPerSec = 0;
+    double tokensPerMin = 0;
+    // 第k次失败后退避 [base * 2^(k-1) / 2, base * 2^(k-1)]，不超过maxBackoffMs
+    double baseBackoffMs = 500;
+    double maxBackoffMs = 30000;
+
+    // 统计信息(毫秒)，多个请求同时等待时分别累计
+    double rateThrottledMs = 0;
+    double retryAfterMs = 0;
+    double backoffMs = 0;
+    unsigned retryAfterNum = 0;
+
+    void configure(double _requestsPerSec, double _tokensPerMin, double _baseBackoffMs);
+
+    // 等待直到预算允许发送一个预估estimatedTokens的请求，返回false表示被取消
+    bool acquire(unsigned estimatedTokens, const atomic<bool>* cancelled = nullptr);
+
+    // 请求完成后用实际token用量修正预估
+    void record(unsigned estimatedTokens, unsigned actualTokens);
+
+    // 第attempt次失败后等待。retryAfterSec > 0时所有请求暂停相应时间，否则按指数退避
+    // 返回false表示被取消
+    bool backoff(unsigned attempt, long retryAfterSec, const atomic<bool>* cancelled = nullptr);
+
+    double getThrottledMs();
+};
+
+#endif //WRAPPERDETECT_LLMRATELIMITER_H
@@ -0,0 +1,41 @@
+//
+// Created on 2026/10/19.
+//
+
+#ifndef WRAPPERDETECT_LLMRESPONSECACHE_H
+#define WRAPPERDETECT_LLMRESPONSECACHE_H
+
+#include <fstream>
+#include <mutex>
+#include <unordered_map>
+
+#include "Utils/Tool/Http.h"
+
+// 按内容寻址的LLM响应缓存，key为hash(model, system prompt, user prompt, temperature, vote index)
+// 持久化为目录下只追加的llm_cache.jsonl，每行 {"key", "message": {"content", "reasoning_content"}, "prompt_tokens", "completion_tokens"}
+// 打开时载入已有记录，同一key以最后一行为准
+class LLMResponseCache {
+private:
+    unordered_map<string, json> entries;
+    ofstream out;
+    mutex cacheMutex;
+
+public:
+    unsigned hitNum = 0;
+    unsigned missNum = 0;
+
+    // 载入并以追加方式打开dir下的缓存文件，目录不存在时创建
+    bool open(const string& dir);
+
+    bool isOpen() const { return out.is_open(); }
+
+    static string getKey(const string& model, const string& SysPrompt, const string& UserPrompt,
+                         float temperature, unsigned voteIdx);
+
+    // 命中时把记录写入entry
+    bool lookup(const string& key, json& entry);
+
+    void insert(const string& key, const json& entry);
+};
+
+#endif //WRAPPERDETECT_LLMRESPONSECACHE_H
@@ -15,6 +15,7 @@
 class DebugPass: public EHAWDPass {
 public:
     set<const Function*> preAnalyzedWrappers;
+    set<string> interestingFuncs = {"evp_md_ctx_new_ex"};
 
     DebugPass(GlobalContext* GCtx_, set<const Function*> _preAnalyzed): EHAWDPass(GCtx_) {
         ID = "debug alloc wrapper detection pass";
@@ -24,6 +25,14 @@ public:
     bool doInitialization(Module* M) override;
 
     bool doModulePass(Module* M) override;
+
+    // debug output is printed in analysis order, keep SCCs sequential
+    bool concurrentSCCs() override { return false; }
+
+    bool analyzeFunction(Function* F, SCCTask& task, set<CallBase*>& visitedAllocCalls) override;
+
+    bool confirmWrapper(Function* F, SCCTask& task, set<CallBase*>& visitedAllocCalls,
+                        set<CallBase*>& potentialAllocs, bool operateGlob) override;
 };
 
 #endif //WRAPPERDETECT_DEBUGPASS_H
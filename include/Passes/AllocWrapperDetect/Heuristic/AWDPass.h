@@ -5,6 +5,8 @@
 #ifndef WRAPPERDETECT_AWDPASS_H
 #define WRAPPERDETECT_AWDPASS_H
 
+#include <mutex>
+
 #include "Passes/IterativeModulePass.h"
 
 // find all alloc wrapper, ignore side-effect. Follow the design of SVF
@@ -15,24 +17,6 @@ public:
     set<Function*> AllocWrappers;
     map<Function*, set<CallBase*>> callInWrappers;
 
-    set<string> allocFuncsNames = {"malloc", "calloc", "safe_calloc", "safe_malloc",
-                                   "safecalloc", "safemalloc", "safexcalloc", "safexmalloc",
-                                   "savealloc", "xalloc", "xmalloc", "xcalloc", "alloc", "alloc_check",
-                                   "alloc_clear", "permalloc", "memalign", "aligned_alloc",
-
-                                   "realloc", "reallocarray", "safe_realloc", "saferealloc", "safexrealloc", "mem_realloc", "xrealloc",
-                                   "strdup", "strndup", "__strdup"};
-
-    set<string> copyAPI = {"strcpy", "memcpy", "llvm.memcpy.p0i8.p0i8.i64", "llvm.memcpy.p0.p0.i64", "llvm.memcpy.p0i8.p0i8.i32",
-                           "llvm.memcpy.p0.p0.i32", "llvm.memcpy", "llvm.memmove", "llvm.memmove.p0i8.p0i8.i64", "llvm.memmove.p0.p0.i64",
-                           "llvm.memmove.p0i8.p0i8.i32", "llvm.memmove.p0.p0.i32", "__memcpy_chk", "memmove", "memccpy",
-                           "__strcpy_chk", "stpcpy", "wcscpy"};
-
-    set<string> deallocAPI = {"free"};
-
-    // preserve function return value to args
-    unordered_map<Function*, set<unsigned>> func2args;
-
     AWDPass(GlobalContext* GCtx_): IterativeModulePass(GCtx_) {
         ID = "base alloc wrapper detection pass";
     }
@@ -43,10 +27,34 @@ public:
 
     bool doFinalization(Module* M) override;
 
+    // stream confirmed wrapper F to Ctx->WrapperStream, called once the alloc calls of F are final
+    void emitWrapper(Function* F);
+
     virtual bool traceValueFlow(Value* V, set<Value*>& visitedValues);
 
+    // memoized traceValueFlow for instructions
+    bool reachReturn(Instruction* I);
+
+    // collect all instructions of F that reach return value, in reverse of traceValueFlow
+    void collectReturnReach(Function* F, set<Instruction*>& reached);
+
+    // whether a user of V is return or a call returning V
+    bool flowToReturnDirectly(Value* V);
+
     // for: p = func(p1, ...), we check whether p1 could flow to p
     bool checkFuncArgRet(Function* F, unsigned argNo);
+
+    // all args of F that could flow to its return value
+    set<unsigned> getFuncArgRets(Function* F);
+
+    // build arg-return summaries of all defined functions into Ctx->FlowCache, callee SCCs first
+    void buildArgRetSummaries();
+
+    // summarize F with the current summaries of its callees, return true if summary of F shrinks
+    bool summarizeArgRet(Function* F);
+
+    // args that V always equals, given the values of its operands
+    uint64_t evalArgMask(Value* V, const DenseMap<Value*, uint64_t>& masks);
 };
 
 #endif //WRAPPERDETECT_AWDPASS_H
@@ -10,10 +10,23 @@
 
 typedef enum SideEffectType { Store, Call, SysCall } SideEffectType;
 
+typedef vector<pair<Instruction*, SideEffectType>> SideEffectOps;
+
+// side-effect summary of a function, kinds is a bitmask of (1 << SideEffectType).
+// side-effect instructions are only collected when the function is checked as a wrapper candidate
+typedef struct SideEffectSummary {
+    unsigned kinds = 0;
+    bool materialized = false;
+    SideEffectOps ops;
+} SideEffectSummary;
+
 // LLM-enhanced allocation wrapper detection pass
 class EHAWDPass: public HAWDPass {
 public:
-    map<Function*, set<pair<Instruction*, SideEffectType>>> func2SideEffectOps;
+    // only side-effect functions have a summary
+    unordered_map<Function*, SideEffectSummary> sideEffectSummaries;
+    bool sideEffectAnalyzed = false;
+    mutex sideEffectOpsMutex;
 
     EHAWDPass(GlobalContext* GCtx_): HAWDPass(GCtx_) {
         ID = "simple alloc wrapper detection pass version2";
@@ -21,8 +34,22 @@ public:
 
     void identifySideEffectFunctions() override;
 
+    bool hasSideEffect(Function* F) const { return sideEffectSummaries.count(F); }
+
+    // side-effect instructions of F, stores before calls, nullptr if F has no side-effect
+    const SideEffectOps* getSideEffectOps(Function* F);
+
+    // scan F with the summaries computed so far, return the side-effect kinds and collect instructions into ops if given
+    unsigned scanSideEffects(Function* F, SideEffectOps* ops);
+
     bool doModulePass(Module* M) override;
 
+    // every function is analyzed, side-effects are checked in confirmWrapper
+    bool isSeed(Function* F) override { return true; }
+
+    bool confirmWrapper(Function* F, SCCTask& task, set<CallBase*>& visitedAllocCalls,
+                        set<CallBase*>& potentialAllocs, bool operateGlob) override;
+
     bool checkSimpleAlloc(Function* F, bool &simpleRet, set<CallBase*>& potentialAllocs) override;
 };
 
@@ -7,8 +7,85 @@
 
 #include <vector>
 #include <queue>
+#include <shared_mutex>
 #include "Passes/AllocWrapperDetect/Heuristic/BUAWDPass.h"
 
+// cached intermediate verdicts of a function in its SCC task.
+// alloc calls of a function only grow during the task, so traced calls are never traced again
+typedef struct FunctionVerdict {
+    bool analyzed = false;
+    bool isWrapper = false;
+    // alloc calls already traced, and the ones among them flowing to return value
+    set<CallBase*> tracedAllocCalls;
+    set<CallBase*> returnedAllocCalls;
+    // an alloc call is not returned, F can not become a wrapper in this task any more
+    bool leaked = false;
+    // return values only come from potential allocs, stays true when more alloc calls are returned
+    bool simpleRet = false;
+    bool operateGlob = false;
+} FunctionVerdict;
+
+// worklist item ordered by cost estimate, then by push order
+typedef struct WorkItem {
+    unsigned cost;
+    unsigned order;
+    Function* F;
+
+    bool operator>(const WorkItem& other) const {
+        return cost != other.cost ? cost > other.cost : order > other.order;
+    }
+} WorkItem;
+
+// working state of one SCC in the wavefront scheduler.
+// global maps are only read while a level is running, all writes of a SCC go here and are committed at the level boundary
+typedef struct SCCTask {
+    unsigned sccIdx = 0;
+    set<Function*> members;
+    // cheapest function first
+    priority_queue<WorkItem, vector<WorkItem>, greater<WorkItem>> worklist;
+    unsigned pushed = 0;
+    set<Function*> inWorklist;
+    map<Function*, FunctionVerdict> verdicts;
+    // alloc calls found inside this SCC, overlay of function2AllocCalls
+    map<Function*, set<CallBase*>> allocCalls;
+    map<Function*, set<CallBase*>> callInWrappers;
+    // new wrappers in discovery order
+    vector<Function*> wrappers;
+    set<Function*> wrapperSet;
+
+    // used by IntraAWDPass: function keys claimed by this SCC, LLM logs and verdicts
+    set<string> claimedKeys;
+    vector<vector<string>> logs;
+    map<string, pair<bool, vector<string>>> llmVerdicts;
+
+    // drop results of a run, LLM verdicts are kept so that a rerun does not query again
+    void reset() {
+        worklist = priority_queue<WorkItem, vector<WorkItem>, greater<WorkItem>>();
+        pushed = 0;
+        inWorklist.clear();
+        verdicts.clear();
+        allocCalls.clear();
+        callInWrappers.clear();
+        wrappers.clear();
+        wrapperSet.clear();
+        claimedKeys.clear();
+        logs.clear();
+    }
+
+    void push(Function* F, unsigned cost) {
+        if (!inWorklist.insert(F).second)
+            return;
+        worklist.push(WorkItem{cost, pushed++, F});
+    }
+
+    Function* pop() {
+        Function* F = worklist.top().F;
+        worklist.pop();
+        inWorklist.erase(F);
+        return F;
+    }
+} SCCTask;
+
 // heuristic simple alloc wrapper detection
 // ToDo: API side effect: calling free and simple alloc not to be returned;
 class HAWDPass: public BUAWDPass {
@@ -17,11 +94,16 @@ private:
     set<Function*> sideEffectFuncs;
 
 public:
-    set<string> sensiAPI = {"pthread_mutex_init"};
-
     // 辅助变量
     set<Function*> visiting;
 
+    // callers outside the SCC of a new wrapper, they are analyzed in their own SCC even if they have side-effect
+    set<Function*> pendingSeeds;
+
+    // guards results read by running tasks (AllocWrappers, function2AllocCalls, pendingSeeds) against commits,
+    // only contended when SCCs are committed while other SCCs are still running
+    shared_mutex commitMutex;
+
     explicit HAWDPass(GlobalContext* GCtx_): BUAWDPass(GCtx_) {
         ID = "heuristic simple alloc wrapper detection pass";
     }
@@ -43,10 +125,56 @@ public:
         return Ty->isPointerTy() || Ty->isStructTy() || Ty->isArrayTy() || Ty->isVectorTy();
     }
 
-    void promoteToCaller(Function* F, set<CallBase*>& visitedAllocCalls,
-                         queue<Function*>& worklist, set<Function*>& inWorklist);
+    // run SCCs level by level over the condensation DAG, SCCs in the same level are analyzed concurrently
+    void detectWrappers();
+
+    // run every SCC as soon as its callee SCCs are committed, with at most maxInflight SCCs running.
+    // used when tasks block on slow queries: other SCCs keep running and callers are promoted as tasks finish.
+    // a finished task waits until canCommit allows it, so ties between SCCs are resolved by SCC index
+    void detectWrappersAsync(unsigned maxInflight);
+
+    // async scheduler: whether a finished task may be committed given the SCCs committed so far
+    virtual bool canCommit(SCCTask& task, const vector<bool>& committedSCCs) { return true; }
+
+    // whether a finished task conflicts with committed results and has to be analyzed again before its commit
+    virtual bool needsRerun(SCCTask& task) { return false; }
+
+    // promote new wrappers of a committed task to callers outside its SCC
+    void promoteCommittedWrappers(SCCTask& task);
+
+    void runSCCTask(SCCTask& task);
+
+    // commit writes of a finished task. the level scheduler commits tasks of a level in SCC order,
+    // the async scheduler commits a task once canCommit allows it and needsRerun is false
+    virtual void commitTask(SCCTask& task);
+
+    // whether SCCs of a level may be analyzed concurrently
+    virtual bool concurrentSCCs() { return true; }
+
+    // whether F is put into the worklist of its SCC at the beginning
+    virtual bool isSeed(Function* F) { return !sideEffectFuncs.count(F); }
+
+    // return true if F is a simple allocation wrapper
+    virtual bool analyzeFunction(Function* F, SCCTask& task, set<CallBase*>& visitedAllocCalls);
+
+    // final check after F passes return value analysis
+    virtual bool confirmWrapper(Function* F, SCCTask& task, set<CallBase*>& visitedAllocCalls,
+                                set<CallBase*>& potentialAllocs, bool operateGlob) { return true; }
+
+    bool isAllocWrapper(Function* F, SCCTask& task) {
+        if (task.wrapperSet.count(F))
+            return true;
+        shared_lock<shared_mutex> lock(commitMutex);
+        return AllocWrappers.count(F);
+    }
+
+    void promoteToCaller(Function* F, set<CallBase*>& visitedAllocCalls, SCCTask& task);
+
+    // cheap estimate of the work to analyze F: number of callsites, stores and returns
+    unsigned getAnalysisCost(Function* F);
 
-    void checkWhetherAlloc(Function* F, bool& isAlloc, bool& everyAllocReturned, set<CallBase*>& visitedAllocCalls);
+    // trace alloc calls of F not traced before, returns false if F has no new alloc call since last analysis
+    bool checkWhetherAlloc(Function* F, FunctionVerdict& verdict, SCCTask& task);
 
     void processPotentialAllocs(Function* F, set<CallBase*>& potentialAllocs);
 
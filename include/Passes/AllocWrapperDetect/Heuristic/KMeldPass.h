@@ -8,10 +8,18 @@
 #include <llvm/IR/BasicBlock.h>
 #include "Passes/IterativeModulePass.h"
 
+#include <atomic>
+
 class KMeldPass: public IterativeModulePass {
 public:
+    // forward analysis verdict of a callsite
+    enum ForwardVerdict: uint8_t { VerdictUnknown = 0, VerdictFail = 1, VerdictPass = 2 };
+
     set<Function*> AllocWrappers;
 
+    // callsite id in Ctx->CG -> ForwardVerdict, a callsite calling several targets is analyzed only once
+    vector<atomic<uint8_t>> forwardVerdicts;
+
     KMeldPass(GlobalContext* GCtx_): IterativeModulePass(GCtx_) {
         ID = "base alloc wrapper detection pass";
     }
@@ -26,6 +34,12 @@ public:
     // check whether a callsite of F: 1.null check, 2.initialization
     bool forwardAnalysis(CallBase* CB);
 
+    // cached forwardAnalysis of callsite id
+    bool getForwardVerdict(unsigned callsiteID);
+
+    // every callsite of F passes forwardAnalysis, stop at the first failed callsite
+    bool checkCallsites(Function* F);
+
     bool isNullValue(Value *v);
 
     bool isNullComparison(ICmpInst *icmp, CallBase *targetCB);
@@ -9,6 +9,9 @@
 #include "Utils/Basic/SourceCodeInfo.h"
 
 #include "LLMQuery/LLMAnalyzer.h"
+#include "LLMQuery/LLMLogSink.h"
+
+#include <future>
 
 
 // Intra-procedural LLM-enhanced allocation wrapper detection pass
@@ -21,17 +24,49 @@ private:
 public:
     string SummarizingTemplate;
     LLMAnalyzer* llmAnalyzer;
+    // "cout"时在提交SCC时打印文本日志，否则每次分类的结构化记录写入logSink
     string logDir;
+    LLMLogSink* logSink = nullptr;
+    // function keys already sent to LLM in current run, guarded by commitMutex
+    set<string> visitedKeys;
+    // key -> SCCs containing a function with the key in ascending order, only for keys of several SCCs
+    unordered_map<string, vector<unsigned>> keySCCs;
+    // SCCs analyzed at the same time, SCCs waiting for LLM answers do not block the others
+    unsigned maxInflightSCCs;
+
+    // 规范化后相同的prompt(宏生成或复制粘贴的函数)只分类一次，结果共享给所有相同prompt的函数
+    bool dedupPrompts = true;
+    // normalized prompt -> (key of the function that queried, verdict and logs of the query)
+    unordered_map<string, pair<string, shared_future<pair<bool, vector<string>>>>> promptVerdicts;
+    mutex promptVerdictsMutex;
+    atomic<unsigned> sharedPromptNum{0};
 
     IntraAWDPass(GlobalContext* GCtx_, unordered_map<string, FunctionInfo>& _sourceInfos, string _summarizingTemplate,
-                 LLMAnalyzer* _analyzer, string _intraSysPrompt = "", string _intraUserPrompt = "", string _logDir = ""):
+                 LLMAnalyzer* _analyzer, string _intraSysPrompt = "", string _intraUserPrompt = "", string _logDir = "",
+                 unsigned _maxInflightSCCs = 8):
         EHAWDPass(GCtx_), sourceInfos(_sourceInfos), SummarizingTemplate(_summarizingTemplate), llmAnalyzer(_analyzer),
-        IntraSysPrompt(_intraSysPrompt), IntraUserTemplate(_intraUserPrompt), logDir(_logDir)
+        IntraSysPrompt(_intraSysPrompt), IntraUserTemplate(_intraUserPrompt), logDir(_logDir),
+        maxInflightSCCs(_maxInflightSCCs)
         {
         ID = "LLM-enhanced simple alloc wrapper detection pass";
     }
 
     bool doModulePass(Module* M) override;
+
+    // classify a rendered prompt, functions whose normalized prompts are identical wait for the same query
+    pair<bool, vector<string>> classifyPrompt(const string& key, const string& funcName, string& userPrompt);
+
+    // source info of F and its key, nullptr if F is not in the source info file
+    const FunctionInfo* getSourceInfo(Function* F, string& key);
+
+    bool canCommit(SCCTask& task, const vector<bool>& committedSCCs) override;
+
+    bool needsRerun(SCCTask& task) override;
+
+    bool confirmWrapper(Function* F, SCCTask& task, set<CallBase*>& visitedAllocCalls,
+                        set<CallBase*>& potentialAllocs, bool operateGlob) override;
+
+    void commitTask(SCCTask& task) override;
 };
 
 #endif //WRAPPERDETECT_INTRAAWDPASS_H
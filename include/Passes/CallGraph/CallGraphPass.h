@@ -29,8 +29,6 @@ public:
 
     virtual void analyzeVirtualCall(CallBase* callInst, FuncSet* FS) {}
 
-    void unrollLoops(Function* F);
-
     bool isVirtualCall(CallBase* CI);
 
     bool isVirtualFunction(Function* F);
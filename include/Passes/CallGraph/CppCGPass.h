@@ -13,6 +13,23 @@ typedef enum {
     TEMPLATE = 0x4 // template class
 } CLASSATTR;
 
+// class hierarchy facts collected from one module, merged into CppCGPass before virtual-call resolution
+typedef struct CHAFragment {
+    set<string> ClassNames;
+    unordered_map<string, set<string>> BottomUpClassHierarchyChain;
+    unordered_map<string, set<string>> TopDownClassHierarchyChain;
+    unordered_map<string, size_t> ClassHierarchy;
+    unordered_map<string, vector<vector<const Function*>>> virtualFuncVecs;
+    unordered_map<string, const GlobalValue*> vtables;
+    // debug messages of the parallel scan, printed when the fragment is merged
+    vector<string> DebugLogs;
+
+    void addInheritEdge(const string& subClass, const string& baseClass) {
+        BottomUpClassHierarchyChain[subClass].insert(baseClass);
+        TopDownClassHierarchyChain[baseClass].insert(subClass);
+    }
+} CHAFragment;
+
 // support virtual call analysis, using CHA
 class CppCGPass: public KELPPass {
 private:
@@ -31,6 +48,8 @@ private:
 
     unordered_map<string, const GlobalValue*> vtables;
 
+    // whether the per-module fragments of all modules have been collected and merged
+    bool fragmentsMerged = false;
 
 public:
     CppCGPass(GlobalContext* Ctx_): KELPPass(Ctx_) {
@@ -43,14 +62,20 @@ public:
     // virtual call analysis
     void analyzeVirtualCall(CallBase* callInst, FuncSet* FS) override;
 
+    // scan vtables and constructors/destructors of M, only touches the fragment so modules can be scanned in parallel
+    void collectCHAFragment(Module* M, CHAFragment& fragment);
+
+    // merge the fragment of one module into the class hierarchy
+    void mergeCHAFragment(CHAFragment& fragment);
+
     // F is a constructor or destructor
-    void connectInheritEdgeViaCall(const Function* F, const CallBase* cs);
+    void connectInheritEdgeViaCall(const Function* F, const CallBase* cs, CHAFragment& fragment);
 
     // F is a constructor or destructor
-    void connectInheritEdgeViaStore(const Function* F, const StoreInst* SI);
+    void connectInheritEdgeViaStore(const Function* F, const StoreInst* SI, CHAFragment& fragment);
 
     // analyze vtables
-    void analyzeVTables(Module* M);
+    void analyzeVTables(Module* M, CHAFragment& fragment);
 
     void addFuncToFuncVector(vector<const Function*> &v, const Function* fun);
 };
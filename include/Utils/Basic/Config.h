@@ -8,5 +8,7 @@
 // signature match
 extern bool debug_mode;
 extern int max_type_layer;
+// worker threads used by parallel analysis, 0 means all hardware threads
+extern unsigned analysis_threads;
 
 #endif //WRAPPERDETECT_CONFIG_H
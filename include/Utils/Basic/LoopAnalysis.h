@@ -0,0 +1,46 @@
+//
+// Created on 2026/10/19.
+//
+
+#ifndef WRAPPERDETECT_LOOPANALYSIS_H
+#define WRAPPERDETECT_LOOPANALYSIS_H
+
+#include <llvm/IR/Dominators.h>
+#include <llvm/Analysis/LoopInfo.h>
+#include <llvm/ADT/DenseMap.h>
+
+#include <memory>
+#include <mutex>
+
+using namespace std;
+using namespace llvm;
+
+// 按函数缓存的循环分析结果，由所有pass共享，不修改IR
+// 无环函数只做一次DFS即可判定，有环函数构建一次DominatorTree与LoopInfo计算视图后即释放
+// getSuccessor提供去掉回边后的CFG视图: 循环latch的第0个后继被重定向到循环出口，
+// 重定向规则与原先直接改写IR的unrollLoops一致
+class LoopAnalysisCache {
+private:
+    struct FunctionLoopInfo {
+        bool hasLoop = false;
+        // 是否已计算acyclic视图
+        bool viewBuilt = false;
+        // latch terminator -> 视图中的第0个后继
+        DenseMap<const Instruction*, BasicBlock*> redirectedSuccs;
+    };
+
+    DenseMap<const Function*, unique_ptr<FunctionLoopInfo>> cache;
+    mutex cacheMutex;
+
+    // 调用者需持有cacheMutex
+    FunctionLoopInfo& getInfo(const Function* F);
+    void buildAcyclicView(const Function* F, FunctionLoopInfo& info);
+
+    static bool detectCycle(const Function* F);
+
+public:
+    // acyclic视图下TI的第idx个后继
+    BasicBlock* getSuccessor(const Instruction* TI, unsigned idx);
+};
+
+#endif //WRAPPERDETECT_LOOPANALYSIS_H
@@ -5,10 +5,9 @@
 #ifndef WRAPPERDETECT_TARJAN_H
 #define WRAPPERDETECT_TARJAN_H
 
-#include <llvm/IR/Function.h>
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/STLExtras.h>
 
-#include <unordered_set>
-#include <stack>
 #include <vector>
 
 using namespace std;
@@ -17,37 +16,25 @@ using namespace llvm;
 // 分析强连通分量并按照逆拓扑序填入SCC中
 // 假如有图: 1 -> 2, 2 -> 3, 3 -> 4, 4 -> 2, 4 -> 5
 // 分析结束后有SCC为: { {5}, {2, 3, 4}, {1} }
+// 节点为[0, N)的稠密ID，使用显式栈迭代实现，避免深调用链上递归爆栈
 class Tarjan {
 private:
-    unordered_map<Function*, set<Function*>> depCG;
-    unordered_set<Function*> funcs;
-
-    unordered_set<Function*> depVisit;
-    stack<Function*> Stack;
-    unordered_map<Function*, int> dfn;
-    unordered_map<Function*, int> low;
-    unordered_map<Function*, bool> inStack;
-    vector<Function*> sc;
-    vector<vector<Function*>> SCC;
-    int ts = 1;
-    int sccSize = 0;
-    int rec = 0;
-    int biggest = 0;
+    unsigned N;
+    function_ref<ArrayRef<unsigned>(unsigned)> succs;
+    function_ref<bool(unsigned)> isNode;
 
 public:
-    Tarjan(unordered_map<Function*, set<Function*>> _depCG) {
-        depCG = _depCG;
-        for (auto item : _depCG) {
-            funcs.insert(item.first);
-            for (auto callee: item.second)
-                funcs.insert(callee);
-        }
-        depVisit.clear();
-    };
-
-    void getSCC(vector<vector<Function*>> &);
-
-    void dfs(Function *F);
+    // 统计信息
+    unsigned partitions = 0;
+    unsigned sccSize = 0;
+    unsigned rec = 0;
+    unsigned biggest = 0;
+
+    // succs(v)返回v的后继，isNode(v)为false的节点不参与划分
+    Tarjan(unsigned N_, function_ref<ArrayRef<unsigned>(unsigned)> succs_, function_ref<bool(unsigned)> isNode_):
+        N(N_), succs(succs_), isNode(isNode_) {}
+
+    void getSCC(vector<vector<unsigned>>& ans);
 };
 
 #endif //WRAPPERDETECT_TARJAN_H
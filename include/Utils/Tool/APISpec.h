@@ -0,0 +1,66 @@
+//
+// Created on 2026/10/19.
+//
+
+#ifndef WRAPPERDETECT_APISPEC_H
+#define WRAPPERDETECT_APISPEC_H
+
+#include "Utils/Basic/TypeDecls.h"
+
+// API在wrapper分析中的角色，一个函数可以有多个角色
+enum APIRole : unsigned {
+    AllocAPI = 1,
+    CopyAPI = 1 << 1,
+    DeallocAPI = 1 << 2,
+    SensitiveAPI = 1 << 3
+};
+
+// 分配/拷贝/释放/敏感API规范，默认从resources/api_spec.json加载，文件缺失时使用内置列表
+// 加载模块后按函数名解析一次为Function* -> role表，之后的查询不再构造字符串
+class APISpec {
+private:
+    bool resolved = false;
+    DenseMap<const Function*, unsigned> roles;
+
+public:
+    // 内置列表，仅在规范文件缺失或文件中没有对应类别时使用
+    set<string> allocNames = {"malloc", "calloc", "safe_calloc", "safe_malloc",
+                              "safecalloc", "safemalloc", "safexcalloc", "safexmalloc",
+                              "savealloc", "xalloc", "xmalloc", "xcalloc", "alloc", "alloc_check",
+                              "alloc_clear", "permalloc", "memalign", "aligned_alloc",
+
+                              "realloc", "reallocarray", "safe_realloc", "saferealloc", "safexrealloc", "mem_realloc", "xrealloc",
+                              "strdup", "strndup", "__strdup"};
+
+    set<string> copyNames = {"strcpy", "memcpy", "llvm.memcpy.p0i8.p0i8.i64", "llvm.memcpy.p0.p0.i64", "llvm.memcpy.p0i8.p0i8.i32",
+                             "llvm.memcpy.p0.p0.i32", "llvm.memcpy", "llvm.memmove", "llvm.memmove.p0i8.p0i8.i64", "llvm.memmove.p0.p0.i64",
+                             "llvm.memmove.p0i8.p0i8.i32", "llvm.memmove.p0.p0.i32", "__memcpy_chk", "memmove", "memccpy",
+                             "__strcpy_chk", "stpcpy", "wcscpy"};
+
+    set<string> deallocNames = {"free"};
+
+    set<string> sensitiveNames = {"pthread_mutex_init"};
+
+    // 文件中出现的类别替换内置列表，解析失败返回false
+    // optional为true时文件不存在不算错误，继续使用内置列表
+    bool loadSpecFile(const string& path, bool optional = false);
+
+    // 程序中定义了同名函数的分配函数不再视为分配API，并从allocNames中移除
+    void resolve(const ModuleList& modules);
+
+    bool isResolved() const { return resolved; }
+
+    unsigned getRole(const Function* F) const {
+        if (!F)
+            return 0;
+        auto it = roles.find(F);
+        return it == roles.end() ? 0 : it->second;
+    }
+
+    bool isAlloc(const Function* F) const { return getRole(F) & AllocAPI; }
+    bool isCopy(const Function* F) const { return getRole(F) & CopyAPI; }
+    bool isDealloc(const Function* F) const { return getRole(F) & DeallocAPI; }
+    bool isSensitive(const Function* F) const { return getRole(F) & SensitiveAPI; }
+};
+
+#endif //WRAPPERDETECT_APISPEC_H
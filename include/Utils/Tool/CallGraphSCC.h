@@ -0,0 +1,40 @@
+//
+// Created on 2026/10/19.
+//
+
+#ifndef WRAPPERDETECT_CALLGRAPHSCC_H
+#define WRAPPERDETECT_CALLGRAPHSCC_H
+
+#include "Utils/Tool/FrozenCallGraph.h"
+
+// 冻结call graph上的SCC划分、condensation DAG及拓扑层次，每个call graph只计算一次
+// SCC按逆拓扑序编号(被调用者在前)，与GlobalContext::SCC下标一致
+// 叶子SCC(不调用其它SCC)层次为0，其余SCC层次为其callee SCC最大层次加1，同一层的SCC之间互不调用
+class CallGraphSCC {
+public:
+    static const unsigned InvalidSCC = ~0U;
+
+    bool built = false;
+
+    // function id -> SCC下标，不在任何调用边上的函数为InvalidSCC
+    vector<unsigned> sccOf;
+    // condensation DAG，邻居按SCC下标升序
+    vector<vector<unsigned>> sccCallees;
+    vector<vector<unsigned>> sccCallers;
+    // SCC -> 层次
+    vector<unsigned> levels;
+    // 层次 -> 该层的SCC，按SCC下标升序
+    vector<vector<unsigned>> levelSCCs;
+
+    // 计算SCC并把每个SCC中的函数写入SCC
+    void build(const FrozenCallGraph& CG, vector<vector<Function*>>& SCC);
+
+    unsigned getSCCIndex(const FrozenCallGraph& CG, const Function* F) const {
+        FrozenCallGraph::NodeID id = CG.getFunctionID(F);
+        return id == FrozenCallGraph::InvalidID ? InvalidSCC : sccOf[id];
+    }
+
+    unsigned getNumLevels() const { return levelSCCs.size(); }
+};
+
+#endif //WRAPPERDETECT_CALLGRAPHSCC_H
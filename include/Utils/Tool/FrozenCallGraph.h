@@ -0,0 +1,122 @@
+//
+// Created on 2026/10/19.
+//
+
+#ifndef WRAPPERDETECT_FROZENCALLGRAPH_H
+#define WRAPPERDETECT_FROZENCALLGRAPH_H
+
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/STLExtras.h>
+#include <llvm/ADT/iterator_range.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include "Utils/Basic/TypeDecls.h"
+#include "Utils/Tool/FunctionFacts.h"
+
+// call graph构建完成后冻结得到的只读CSR图
+// 函数与callsite分别按模块、函数、指令顺序编号为稠密ID
+// 每个邻接表保留原map中集合的遍历顺序，因此遍历结果与直接遍历Callees/Callers等map一致
+class FrozenCallGraph {
+public:
+    typedef unsigned NodeID;
+    static const NodeID InvalidID = ~0U;
+
+    struct IDToFunction {
+        const vector<Function*>* funcs;
+        Function* operator()(NodeID id) const { return (*funcs)[id]; }
+    };
+    struct IDToCallsite {
+        const vector<CallBase*>* callsites;
+        CallBase* operator()(NodeID id) const { return (*callsites)[id]; }
+    };
+    typedef iterator_range<mapped_iterator<const NodeID*, IDToFunction>> FunctionRange;
+    typedef iterator_range<mapped_iterator<const NodeID*, IDToCallsite>> CallsiteRange;
+
+private:
+    // 压缩邻接表: edges[offsets[i], offsets[i + 1])为节点i的邻居
+    struct CSR {
+        vector<unsigned> offsets;
+        vector<NodeID> edges;
+
+        ArrayRef<NodeID> row(NodeID id) const {
+            if (id == InvalidID || id + 1 >= offsets.size())
+                return ArrayRef<NodeID>();
+            return ArrayRef<NodeID>(edges.data() + offsets[id], edges.data() + offsets[id + 1]);
+        }
+
+        size_t memorySize() const {
+            return offsets.capacity() * sizeof(unsigned) + edges.capacity() * sizeof(NodeID);
+        }
+    };
+
+    bool built = false;
+
+    vector<Function*> funcs;
+    DenseMap<const Function*, NodeID> funcIDs;
+    vector<CallBase*> callsites;
+    DenseMap<const CallBase*, NodeID> callsiteIDs;
+    // callsite -> 所在函数
+    vector<NodeID> callsiteOwners;
+
+    // function -> callee functions (CallMaps)
+    CSR calleeFuncCSR;
+    // function -> caller functions (CalledMaps)
+    CSR callerFuncCSR;
+    // callsite -> callee functions (Callees)
+    CSR callsiteCalleeCSR;
+    // function -> callsites calling it (Callers)
+    CSR callerCallsiteCSR;
+
+    FunctionRange toFunctions(ArrayRef<NodeID> ids) const {
+        return map_range(ids, IDToFunction{&funcs});
+    }
+
+    CallsiteRange toCallsites(ArrayRef<NodeID> ids) const {
+        return map_range(ids, IDToCallsite{&callsites});
+    }
+
+public:
+    // 由call graph pass构建的map冻结得到CSR图
+    void build(const ModuleList& modules, const FunctionFacts& facts, const CalleeMap& callees, const CallerMap& callers,
+               const CallMap& callMaps, const CalledMap& calledMaps);
+
+    bool isBuilt() const { return built; }
+
+    unsigned getNumFunctions() const { return funcs.size(); }
+    unsigned getNumCallsites() const { return callsites.size(); }
+    unsigned getNumEdges() const { return calleeFuncCSR.edges.size(); }
+
+    NodeID getFunctionID(const Function* F) const {
+        auto it = funcIDs.find(F);
+        return it == funcIDs.end() ? InvalidID : it->second;
+    }
+
+    NodeID getCallsiteID(const CallBase* CI) const {
+        auto it = callsiteIDs.find(CI);
+        return it == callsiteIDs.end() ? InvalidID : it->second;
+    }
+
+    Function* getFunction(NodeID id) const { return funcs[id]; }
+    CallBase* getCallsite(NodeID id) const { return callsites[id]; }
+    NodeID getCallsiteOwner(NodeID id) const { return callsiteOwners[id]; }
+
+    // ID形式的邻接表
+    ArrayRef<NodeID> calleeIDs(NodeID F) const { return calleeFuncCSR.row(F); }
+    ArrayRef<NodeID> callerIDs(NodeID F) const { return callerFuncCSR.row(F); }
+    ArrayRef<NodeID> callsiteCalleeIDs(NodeID CI) const { return callsiteCalleeCSR.row(CI); }
+    ArrayRef<NodeID> callerCallsiteIDs(NodeID F) const { return callerCallsiteCSR.row(F); }
+
+    // 对象形式的邻接表，分别对应CallMaps、CalledMaps、Callees与Callers
+    FunctionRange callees(const Function* F) const { return toFunctions(calleeFuncCSR.row(getFunctionID(F))); }
+    FunctionRange callers(const Function* F) const { return toFunctions(callerFuncCSR.row(getFunctionID(F))); }
+    FunctionRange callees(const CallBase* CI) const { return toFunctions(callsiteCalleeCSR.row(getCallsiteID(CI))); }
+    CallsiteRange callerCallsites(const Function* F) const { return toCallsites(callerCallsiteCSR.row(getFunctionID(F))); }
+
+    size_t memorySize() const;
+
+    // 对比CSR图与冻结后释放的四个map的内存占用(map部分为按容器布局的估算值)，须在释放map前调用
+    void printMemoryReport(raw_ostream& os, const CalleeMap& callees, const CallerMap& callers,
+                           const CallMap& callMaps, const CalledMap& calledMaps) const;
+};
+
+#endif //WRAPPERDETECT_FROZENCALLGRAPH_H
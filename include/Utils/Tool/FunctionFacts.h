@@ -0,0 +1,49 @@
+//
+// Created on 2026/10/19.
+//
+
+#ifndef WRAPPERDETECT_FUNCTIONFACTS_H
+#define WRAPPERDETECT_FUNCTIONFACTS_H
+
+#include <llvm/IR/Instructions.h>
+
+#include "Utils/Basic/TypeDecls.h"
+
+// 单个函数中各类指令的扁平列表，均按指令顺序排列
+typedef struct FunctionFactTable {
+    vector<CallBase*> callsites;
+    vector<StoreInst*> stores;
+    vector<ReturnInst*> returns;
+    // 直接以全局变量为操作数的指令，每个操作数记录一次
+    vector<pair<Instruction*, GlobalVariable*>> globalUses;
+} FunctionFactTable;
+
+// 所有模块中已定义函数的IR事实表，在call graph分析开始前并行构建一次，之后只读
+// IR在分析过程中不会被修改，各pass查询事实表而不是重复遍历指令
+class FunctionFacts {
+private:
+    bool built = false;
+    DenseMap<const Function*, unsigned> funcIndex;
+    vector<FunctionFactTable> tables;
+    // 声明或未知函数返回的空表
+    FunctionFactTable emptyTable;
+
+    static void collect(Function* F, FunctionFactTable& table);
+
+public:
+    void build(const ModuleList& modules);
+
+    bool isBuilt() const { return built; }
+
+    const FunctionFactTable& get(const Function* F) const {
+        auto it = funcIndex.find(F);
+        return it == funcIndex.end() ? emptyTable : tables[it->second];
+    }
+
+    const vector<CallBase*>& callsites(const Function* F) const { return get(F).callsites; }
+    const vector<StoreInst*>& stores(const Function* F) const { return get(F).stores; }
+    const vector<ReturnInst*>& returns(const Function* F) const { return get(F).returns; }
+    const vector<pair<Instruction*, GlobalVariable*>>& globalUses(const Function* F) const { return get(F).globalUses; }
+};
+
+#endif //WRAPPERDETECT_FUNCTIONFACTS_H
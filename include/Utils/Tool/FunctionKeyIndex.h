@@ -0,0 +1,34 @@
+//
+// Created on 2026/10/19.
+//
+
+#ifndef WRAPPERDETECT_FUNCTIONKEYINDEX_H
+#define WRAPPERDETECT_FUNCTIONKEYINDEX_H
+
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/IR/Function.h>
+#include <unordered_map>
+
+#include "Utils/Basic/TypeDecls.h"
+
+// 所有模块中带调试信息的已定义函数按key索引，key与wrapper输出格式一致: name<file<line
+// name为去掉.数字后缀的函数名，同一key可能对应多个函数(如不同模块中的同名static函数)
+class FunctionKeyIndex {
+private:
+    unordered_map<string, vector<const Function*>> index;
+
+public:
+    static string getKey(const string& funcName, const string& fileName, unsigned line);
+
+    // F的key，F需带调试信息
+    static string getKey(const Function* F);
+
+    void build(const ModuleList& modules);
+
+    // 返回key对应的函数，不存在时返回空
+    ArrayRef<const Function*> lookup(const string& funcName, const string& fileName, unsigned line) const;
+
+    size_t size() const { return index.size(); }
+};
+
+#endif //WRAPPERDETECT_FUNCTIONKEYINDEX_H
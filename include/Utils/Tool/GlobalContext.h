@@ -4,7 +4,14 @@
 #define WRAPPERDETECT_GLOBALCONTEXT_H
 
 #include "Utils/Basic/TypeDecls.h"
+#include "Utils/Basic/LoopAnalysis.h"
+#include "Utils/Tool/FrozenCallGraph.h"
+#include "Utils/Tool/CallGraphSCC.h"
+#include "Utils/Tool/FunctionFacts.h"
+#include "Utils/Tool/APISpec.h"
+#include "Utils/Tool/WrapperSink.h"
 #include <map>
+#include <mutex>
 
 class CommonUtil {
 public:
@@ -43,6 +50,18 @@ public:
     static Function* getBaseFunction(Value* V);
 };
 
+// wrapper pass的值流缓存，只依赖IR与API表，同一次运行中的多个wrapper pass共享
+struct ValueFlowCache {
+    // function -> args that the return value always comes from, bit i for the i-th arg.
+    // computed bottom-up over SCCs before detection and read-only afterwards, args beyond 64 are never recorded
+    unordered_map<Function*, uint64_t> argRetSummaries;
+    bool argRetSummariesBuilt = false;
+
+    // function -> instructions whose value could reach return value, built on the first query in the function
+    unordered_map<Function*, set<Instruction*>> returnReachCache;
+    mutex returnReachMutex;
+};
+
 // 保存中间及最终结果的结构体
 struct GlobalContext {
     GlobalContext() = default;
@@ -80,9 +99,24 @@ struct GlobalContext {
     // Map a function to the functions who call it
     CalledMap CalledMaps;
 
-    // Call Graph SCC
+    // 分配/拷贝/释放/敏感API表，加载模块后解析一次
+    APISpec APIs;
+
+    // 每个函数的callsite、store、return及全局变量使用列表，call graph分析开始前构建
+    FunctionFacts Facts;
+
+    // 循环分析缓存，提供不修改IR的acyclic CFG视图
+    LoopAnalysisCache LoopCache;
+
+    // call graph构建完成后冻结的CSR图，wrapper分析阶段只读，冻结后Callees、Callers、CallMaps与CalledMaps即被释放
+    FrozenCallGraph CG;
+
+    // Call Graph SCC，按逆拓扑序排列
     vector<vector<Function*>> SCC;
 
+    // SCC的condensation DAG与拓扑层次，与SCC一同在call graph冻结后计算一次
+    CallGraphSCC SCCDAG;
+
     // 将一个函数签名映射为对应函数集合s
     DenseMap<size_t, FuncSet> sigFuncsMap;
 
@@ -95,9 +129,22 @@ struct GlobalContext {
     ModuleNameMap ModuleMaps;
     set<string> InvolvedModules;
 
+    // 值流缓存，由各wrapper pass共享
+    ValueFlowCache FlowCache;
+
     set<Function*> AllocWrappers;
     map<Function*, set<CallBase*>> callInWrappers;
     set<string> AllocWrapperKeys;
+
+    // wrapper确认后立即写出的JSONL流，由-wrapper-stream-file打开
+    WrapperSink WrapperStream;
+
+    // 清空wrapper分析结果，以便在同一call graph上运行下一个wrapper pass
+    void clearWrapperResults() {
+        AllocWrappers.clear();
+        callInWrappers.clear();
+        AllocWrapperKeys.clear();
+    }
 };
 
 
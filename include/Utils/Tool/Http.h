@@ -5,6 +5,7 @@
 #ifndef WRAPPERDETECT_HTTP_H
 #define WRAPPERDETECT_HTTP_H
 
+#include <atomic>
 #include <string>
 #include "nlohmann/json.hpp"
 
@@ -14,10 +15,34 @@ using namespace nlohmann;
 size_t WriteCallback(void* contents, size_t size, size_t nmemb, string* s);
 // 省略其他代码，和之前类似
 
-// HTTP GET请求，成功返回true，结果解析到out_json
-bool httpGet(const string& url, json& out_json);
+// 单次请求的耗时与状态码，newConnections为0表示复用了keep-alive连接，status为0表示未收到响应
+// retryAfterSec为响应中Retry-After头给出的秒数，没有时为0
+typedef struct HttpTiming {
+    long status = 0;
+    long retryAfterSec = 0;
+    long newConnections = 0;
+    double connectMs = 0;
+    double totalMs = 0;
+} HttpTiming;
+
+// 进程内所有请求的累计统计
+typedef struct HttpStats {
+    unsigned requestNum = 0;
+    unsigned newConnectionNum = 0;
+    double connectMs = 0;
+    double totalMs = 0;
+} HttpStats;
+
+// 请求复用进程内的curl handle池，同一服务器的连接保持keep-alive
+
+// HTTP GET请求，成功返回true，结果解析到out_json，timing非空时写入本次请求耗时
+bool httpGet(const string& url, json& out_json, HttpTiming* timing = nullptr);
 
 // HTTP POST请求，发送json格式payload，成功返回true，响应json解析到out_json
-bool httpPost(const string& url, const json& payload, json& out_json);
+// cancelled非空且被置为true时中止请求并返回false，curl约每秒检查一次
+bool httpPost(const string& url, const json& payload, json& out_json, HttpTiming* timing = nullptr,
+              const atomic<bool>* cancelled = nullptr);
+
+HttpStats getHttpStats();
 
 #endif //WRAPPERDETECT_HTTP_H
@@ -0,0 +1,21 @@
+//
+// Created on 2026/10/19.
+//
+
+#ifndef WRAPPERDETECT_PARALLEL_H
+#define WRAPPERDETECT_PARALLEL_H
+
+#include <llvm/ADT/STLExtras.h>
+#include <cstddef>
+
+using namespace llvm;
+
+// number of workers used by parallelFor, decided by analysis_threads
+unsigned getAnalysisThreadNum();
+
+// run Fn(0) ... Fn(N - 1) on the session-wide analysis thread pool and wait for all of them.
+// Fn must only touch state owned by its own index (or synchronize by itself).
+// nested calls from a worker run sequentially on that worker.
+void parallelFor(size_t N, function_ref<void(size_t)> Fn);
+
+#endif //WRAPPERDETECT_PARALLEL_H
@@ -0,0 +1,35 @@
+//
+// Created on 2026/10/19.
+//
+
+#ifndef WRAPPERDETECT_WRAPPERSINK_H
+#define WRAPPERDETECT_WRAPPERSINK_H
+
+#include <llvm/IR/InstrTypes.h>
+
+#include <fstream>
+#include <mutex>
+
+#include "Utils/Tool/FrozenCallGraph.h"
+
+// wrapper一经确认即以JSONL追加写出，下游无需等待整个pass结束即可消费部分结果
+// 每行一条记录: {"key": "name<file<line", "calls": [{"file", "line", "col", "callees"}], "pass": ..., "ts": 毫秒时间戳}
+// 同一wrapper在不同pass中会各写一条，未打开时emit不做任何事
+class WrapperSink {
+private:
+    ofstream out;
+    mutex sinkMutex;
+
+public:
+    unsigned NumRecords = 0;
+
+    // 以追加方式打开，失败时返回false
+    bool open(const string& path);
+
+    bool isOpen() const { return out.is_open(); }
+
+    // 写出一条记录并立即flush，calls为F中被确认返回的分配调用
+    void emit(const string& pass, const Function* F, const set<CallBase*>& calls, const FrozenCallGraph& CG);
+};
+
+#endif //WRAPPERDETECT_WRAPPERSINK_H
@@ -3,14 +3,26 @@
 //
 #include "LLMQuery/LLMAnalyzer.h"
 #include "Utils/Tool/Common.h"
-#include <future>
+#include "Utils/Basic/Config.h"
 #include <mutex>
 #include <chrono>
 
-mutex log_mutex;
 mutex stats_mutex;
 
-string LLMAnalyzer::queryLLM(string& SysPrompt, string& UserPrompt, vector<string>& curLogs) {
+// response log of a query, shared by model responses and cached responses
+static string getResponseLog(const json& message) {
+    string totalLog;
+    totalLog.append("************response*************\n");
+    totalLog.append(message["content"].get<string>());
+    if (message.contains("reasoning_content") && message["reasoning_content"].is_string()) {
+        totalLog.append("\n************reasoning****************\n");
+        totalLog.append(message["reasoning_content"].get<string>());
+    }
+    totalLog.append("\n");
+    return totalLog;
+}
+
+static json buildPayload(const string& model, float temperature, const string& SysPrompt, const string& UserPrompt) {
     json payload = {
             {"model", model},
             {"messages", json::array()} // 初始化为空数组
@@ -23,30 +35,97 @@ string LLMAnalyzer::queryLLM(string& SysPrompt, string& UserPrompt, vector<strin
 
     if (temperature != -1)
         payload["temperature"] = temperature;
+    return payload;
+}
+
+// cache entry of one choice, token usage is only recorded once per request
+static json getCacheEntry(const json& message, int input_tokens, int output_tokens) {
+    json entry = {{"message", {{"content", message["content"]}}}, {"prompt_tokens", input_tokens},
+                  {"completion_tokens", output_tokens}};
+    if (message.contains("reasoning_content") && message["reasoning_content"].is_string())
+        entry["message"]["reasoning_content"] = message["reasoning_content"];
+    return entry;
+}
+
+// 发送前按约4字符一个token预估prompt的token数
+static unsigned estimateTokens(const string& SysPrompt, const string& UserPrompt) {
+    return (SysPrompt.size() + UserPrompt.size()) / 4 + 1;
+}
+
+// 429与503说明服务器过载，只有此时遵循Retry-After
+static long getRetryAfter(const HttpTiming& timing) {
+    return timing.status == 429 || timing.status == 503 ? timing.retryAfterSec : 0;
+}
+
+bool LLMAnalyzer::fetchModel(unsigned attempts) {
+    for (unsigned i = 1; i <= attempts; ++i) {
+        // Retry-After的暂停在acquire中等待
+        limiter.acquire(0);
+        json models;
+        HttpTiming timing;
+        if (httpGet(models_url, models, &timing) && models.contains("data") && models["data"].is_array() &&
+            !models["data"].empty() && models["data"][0]["id"].is_string()) {
+            model = models["data"][0]["id"];
+            OP << "model is: " << model << "\n";
+            return true;
+        }
+        if (i < attempts)
+            limiter.backoff(i, getRetryAfter(timing));
+    }
+    OP << "unable to get model information from " << models_url << "\n";
+    return false;
+}
+
+string LLMAnalyzer::queryLLM(string& SysPrompt, string& UserPrompt, vector<string>& curLogs, unsigned voteIdx,
+                             const atomic<bool>* cancelled, LLMUsage* usage) {
+    string cacheKey;
+    if (cache) {
+        cacheKey = LLMResponseCache::getKey(model, SysPrompt, UserPrompt, temperature, voteIdx);
+        json entry;
+        if (cache->lookup(cacheKey, entry)) {
+            curLogs.emplace_back(getResponseLog(entry["message"]));
+            return strip(entry["message"]["content"]);
+        }
+    }
+
+    json payload = buildPayload(model, temperature, SysPrompt, UserPrompt);
+
+    unsigned estimated = estimateTokens(SysPrompt, UserPrompt);
 
     json resp;
     string content = "<Error>";
     unsigned queries = 0;
     while (queries < retry) {
-        if (!httpPost(query_url, payload, resp)) {
+        if (cancelled && cancelled->load())
+            break;
+        if (!limiter.acquire(estimated, cancelled))
+            break;
+        HttpTiming timing;
+        bool success = httpPost(query_url, payload, resp, &timing, cancelled);
+        DBG << "LLM request: status " << timing.status << ", new connections " << timing.newConnections << ", connect "
+            << (long) timing.connectMs << " ms, total " << (long) timing.totalMs << " ms\n";
+        if (!success) {
+            limiter.record(estimated, 0);
             ++queries;
+            if (queries < retry && !limiter.backoff(queries, getRetryAfter(timing), cancelled))
+                break;
             continue;
         }
 
-        content = resp["choices"][0]["message"]["content"];
+        const json& message = resp["choices"][0]["message"];
+        content = message["content"];
         int input_tokens = resp["usage"]["prompt_tokens"];
         int output_tokens = resp["usage"]["completion_tokens"];
 
-        string totalLog;
-        totalLog.append("************response*************\n");
-        totalLog.append(content);
-        if (resp["choices"][0]["message"]["reasoning_content"].is_string()) {
-            string reasoning = resp["choices"][0]["message"]["reasoning_content"];
-            totalLog.append("\n************reasoning****************\n");
-            totalLog.append(reasoning);
+        limiter.record(estimated, input_tokens + output_tokens);
+        if (usage) {
+            usage->inputTokens += input_tokens;
+            usage->outputTokens += output_tokens;
         }
-        totalLog.append("\n");
-        curLogs.emplace_back(totalLog);
+
+        curLogs.emplace_back(getResponseLog(message));
+        if (cache)
+            cache->insert(cacheKey, getCacheEntry(message, input_tokens, output_tokens));
         {
             lock_guard<mutex> lock(stats_mutex);
             totalQueryNum += 1;
@@ -60,49 +139,225 @@ string LLMAnalyzer::queryLLM(string& SysPrompt, string& UserPrompt, vector<strin
 }
 
 
-bool LLMAnalyzer::classify(string& SysPrompt, string& UserPrompt, string SummarizingTemplate, vector<string>& curLogs) {
+void LLMAnalyzer::lookupSamples(string& SysPrompt, string& UserPrompt, unsigned n,
+                                vector<tuple<unsigned, string, string>>& samples, vector<unsigned>& missing) {
+    for (unsigned i = 0; i < n; ++i) {
+        if (cache) {
+            json entry;
+            if (cache->lookup(LLMResponseCache::getKey(model, SysPrompt, UserPrompt, temperature, i), entry)) {
+                samples.emplace_back(i, strip(entry["message"]["content"]), getResponseLog(entry["message"]));
+                continue;
+            }
+        }
+        missing.push_back(i);
+    }
+}
+
+bool LLMAnalyzer::querySamples(string& SysPrompt, string& UserPrompt, const vector<unsigned>& voteIdxs,
+                               vector<tuple<unsigned, string, string>>& samples, const atomic<bool>* cancelled,
+                               LLMUsage* usage) {
+    if (voteIdxs.empty())
+        return true;
+    if (cancelled && cancelled->load())
+        return false;
+
+    json payload = buildPayload(model, temperature, SysPrompt, UserPrompt);
+    payload["n"] = voteIdxs.size();
+    unsigned estimated = estimateTokens(SysPrompt, UserPrompt);
+    if (!limiter.acquire(estimated, cancelled))
+        return false;
+    json resp;
+    HttpTiming timing;
+    bool success = httpPost(query_url, payload, resp, &timing, cancelled);
+    DBG << "LLM multi-sample request: status " << timing.status << ", total " << (long) timing.totalMs << " ms\n";
+    // 4xx(429限流除外)说明服务器不接受n参数，其它失败由单独请求重试
+    if (!success) {
+        limiter.record(estimated, 0);
+        limiter.backoff(1, getRetryAfter(timing), cancelled);
+        if (timing.status >= 400 && timing.status < 500 && timing.status != 429 && !multiSampleRejected.exchange(true))
+            OP << "server rejected multi-sample request (HTTP " << timing.status << "), falling back to separate votes\n";
+        return false;
+    }
+
+    const json& choices = resp["choices"];
+    unsigned received = min(voteIdxs.size(), choices.size());
+    int input_tokens = resp["usage"]["prompt_tokens"];
+    int output_tokens = resp["usage"]["completion_tokens"];
+    limiter.record(estimated, input_tokens + output_tokens);
+    if (usage) {
+        usage->inputTokens += input_tokens;
+        usage->outputTokens += output_tokens;
+    }
+    for (unsigned k = 0; k < received; ++k) {
+        const json& message = choices[k]["message"];
+        string content = message["content"];
+        samples.emplace_back(voteIdxs[k], strip(content), getResponseLog(message));
+        // usage覆盖整个请求，只记在第一个样本上
+        if (cache)
+            cache->insert(LLMResponseCache::getKey(model, SysPrompt, UserPrompt, temperature, voteIdxs[k]),
+                          getCacheEntry(message, k ? 0 : input_tokens, k ? 0 : output_tokens));
+    }
+    {
+        lock_guard<mutex> lock(stats_mutex);
+        totalQueryNum += 1;
+        totalMultiSampleQueryNum += 1;
+        totalInputTokenNum += input_tokens;
+        totalOutputTokenNum += output_tokens;
+    }
+    // 服务器忽略了n参数
+    if (received < voteIdxs.size()) {
+        if (!multiSampleRejected.exchange(true))
+            OP << "server returned " << received << " of " << voteIdxs.size()
+               << " requested samples, falling back to separate votes\n";
+        return false;
+    }
+    return true;
+}
+
+
+namespace {
+// state of one classify call shared with its votes, votes may outlive the call after the answer is decided
+struct VoteRound {
+    string SysPrompt;
+    string UserPrompt;
+    unsigned voteTime;
+    unsigned requiredTime;
     unsigned yesTime = 0;
-    unsigned requiredTime = voteTime / 2;
+    unsigned noTime = 0;
+    // set when the answer is decided, remaining votes stop and in-flight requests are aborted
+    atomic<bool> decided{false};
+    mutex voteMutex;
+    condition_variable voteCV;
+    // logs of counted votes
+    vector<string> logs;
+    LLMUsage usage;
+
+    // yes wins with more than requiredTime votes, no wins once yes can not get there
+    bool isDecided() const { return yesTime > requiredTime || noTime >= voteTime - requiredTime; }
+};
+
+// summarize an unclear answer if needed, then count the vote
+// answers arriving after the decision are not counted
+void finishVote(LLMAnalyzer* analyzer, VoteRound& round, unsigned voteIdx, const string& content,
+                vector<string>& localLogs) {
+    bool isYes = false;
+    if (CmpFirst(content, "yes"))
+        isYes = true;
+    else if (CmpFirst(content, "no"))
+        isYes = false;
+    else if (!round.decided) {
+        localLogs.emplace_back("*********summarizing**************:\n" + content + "\n");
+
+        string empty;
+        string summary = content;
+        string summarized = analyzer->queryLLM(empty, summary, localLogs, voteIdx, &round.decided, &round.usage);
+        isYes = CmpFirst(summarized, "yes");
+    }
+
+    lock_guard<mutex> lock(round.voteMutex);
+    if (round.decided)
+        return;
+    round.logs.insert(round.logs.end(), localLogs.begin(), localLogs.end());
+    if (isYes)
+        ++round.yesTime;
+    else
+        ++round.noTime;
+    if (round.isDecided()) {
+        round.decided = true;
+        round.voteCV.notify_one();
+    }
+}
+
+// 每个投票(含summarizing查询)作为一个任务提交给共享执行器
+void submitVote(LLMAnalyzer* analyzer, const shared_ptr<VoteRound>& round, unsigned voteIdx) {
+    analyzer->executor->submit([analyzer, round, voteIdx]() {
+        // the answer was decided while this vote was queued
+        if (round->decided)
+            return;
+        vector<string> localLogs;
+        string content = analyzer->queryLLM(round->SysPrompt, round->UserPrompt, localLogs, voteIdx, &round->decided,
+                                            &round->usage);
+        finishVote(analyzer, *round, voteIdx, content, localLogs);
+    });
+}
+}
+
+bool LLMAnalyzer::classify(string& SysPrompt, string& UserPrompt, string SummarizingTemplate, vector<string>& curLogs,
+                           ClassifyRecord* record) {
+    shared_ptr<VoteRound> round = make_shared<VoteRound>();
+    round->SysPrompt = SysPrompt;
+    round->UserPrompt = UserPrompt;
+    round->voteTime = voteTime;
+    round->requiredTime = voteTime / 2;
+
     curLogs.emplace_back("*********query**************\n" + UserPrompt + "\n");
     auto start = chrono::high_resolution_clock::now();
-    vector<future<bool>> futures;
-    for (unsigned i = 0; i < voteTime; ++i) {
-        futures.emplace_back(async(launch::async, [&]() -> bool {
-            vector<string> localLogs;
-            string content = queryLLM(SysPrompt, UserPrompt, localLogs);
-            if (CmpFirst(content, "yes")) {
-                lock_guard<mutex> log_lock(log_mutex);
-                curLogs.insert(curLogs.end(), localLogs.begin(), localLogs.end());
-                return true;
+    if (multiSample && !multiSampleRejected && voteTime > 1) {
+        // 一次请求获取全部样本，未得到样本的投票回退为单独请求
+        executor->submit([this, round]() {
+            if (round->decided)
+                return;
+            // 缓存命中的投票先计数，足以决定结果时不再请求
+            vector<tuple<unsigned, string, string>> samples;
+            vector<unsigned> missing;
+            lookupSamples(round->SysPrompt, round->UserPrompt, round->voteTime, samples, missing);
+            for (auto& sample: samples) {
+                vector<string> localLogs = {get<2>(sample)};
+                finishVote(this, *round, get<0>(sample), get<1>(sample), localLogs);
             }
-            else if (CmpFirst(content, "no")) {
-                lock_guard<mutex> log_lock(log_mutex);
-                curLogs.insert(curLogs.end(), localLogs.begin(), localLogs.end());
-                return false;
-            }
-
-            SummarizingTemplate = replaceAll(SummarizingTemplate, "{answer}", content);
-            localLogs.emplace_back("*********summarizing**************:\n" + content + "\n");
+            if (missing.empty() || round->decided)
+                return;
 
-            string empty;
-            string summarized = queryLLM(empty, content, localLogs);
-            {
-                lock_guard<mutex> log_lock(log_mutex);
-                curLogs.insert(curLogs.end(), localLogs.begin(), localLogs.end());
+            samples.clear();
+            querySamples(round->SysPrompt, round->UserPrompt, missing, samples, &round->decided, &round->usage);
+            vector<bool> answered(round->voteTime, false);
+            for (auto& sample: samples) {
+                answered[get<0>(sample)] = true;
+                vector<string> localLogs = {get<2>(sample)};
+                finishVote(this, *round, get<0>(sample), get<1>(sample), localLogs);
             }
-
-            return CmpFirst(summarized, "yes");
-        }));
+            for (unsigned i: missing)
+                if (!answered[i])
+                    submitVote(this, round, i);
+        });
+    }
+    else {
+        for (unsigned i = 0; i < voteTime; ++i)
+            submitVote(this, round, i);
     }
 
-    for (auto& f : futures)
-        if (f.get())
-            yesTime++;
+    bool isSimple;
+    {
+        unique_lock<mutex> lock(round->voteMutex);
+        round->voteCV.wait(lock, [&]() { return round->isDecided(); });
+        round->decided = true;
+        isSimple = round->yesTime > round->requiredTime;
+        curLogs.insert(curLogs.end(), round->logs.begin(), round->logs.end());
+        if (record) {
+            record->answer = isSimple;
+            record->yesVotes = round->yesTime;
+            record->noVotes = round->noTime;
+            record->skippedVotes = voteTime - round->yesTime - round->noTime;
+            record->responses = round->logs;
+            record->inputTokens = round->usage.inputTokens;
+            record->outputTokens = round->usage.outputTokens;
+        }
+        lock_guard<mutex> statsLock(stats_mutex);
+        totalSkippedVoteNum += voteTime - round->yesTime - round->noTime;
+    }
     auto end = chrono::high_resolution_clock::now();
+    if (record)
+        record->latencyMs = chrono::duration<double, milli>(end - start).count();
     // 计算耗时（毫秒）
     long duration_s = chrono::duration_cast<chrono::seconds>(end - start).count();
-    totalLLMTime += duration_s;
-    bool isSimple = yesTime > requiredTime;
+    {
+        lock_guard<mutex> lock(stats_mutex);
+        totalLLMTime += duration_s;
+    }
     curLogs.emplace_back(isSimple ? "final answer: yes" : "final answer: no");
     return isSimple;
-}
\ No newline at end of file
+}
+
+void LLMAnalyzer::waitForVotes() {
+    executor->waitIdle();
+}
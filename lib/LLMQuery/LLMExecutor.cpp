@@ -0,0 +1,62 @@
+//
+// Created on 2026/10/19.
+//
+#include "LLMQuery/LLMExecutor.h"
+
+LLMExecutor::LLMExecutor(unsigned concurrency) {
+    for (unsigned i = 0; i < max(1U, concurrency); ++i)
+        workers.emplace_back([this]() { workerLoop(); });
+}
+
+LLMExecutor::~LLMExecutor() {
+    {
+        lock_guard<mutex> lock(queueMutex);
+        stopping = true;
+    }
+    queueCV.notify_all();
+    for (thread& t: workers)
+        t.join();
+}
+
+void LLMExecutor::workerLoop() {
+    while (true) {
+        Job job;
+        {
+            unique_lock<mutex> lock(queueMutex);
+            queueCV.wait(lock, [&]() { return stopping || !queue.empty(); });
+            if (queue.empty())
+                return;
+            job = std::move(queue.front());
+            queue.pop_front();
+            ++running;
+            totalQueueWaitMs += chrono::duration<double, milli>(chrono::steady_clock::now() - job.submitTime).count();
+        }
+        job.fn();
+        {
+            lock_guard<mutex> lock(queueMutex);
+            --running;
+            if (queue.empty() && !running)
+                idleCV.notify_all();
+        }
+    }
+}
+
+void LLMExecutor::submit(function<void()> fn) {
+    {
+        lock_guard<mutex> lock(queueMutex);
+        queue.push_back(Job{std::move(fn), chrono::steady_clock::now()});
+        ++totalJobNum;
+        maxQueueDepth = max(maxQueueDepth, queue.size());
+    }
+    queueCV.notify_one();
+}
+
+size_t LLMExecutor::getQueueDepth() {
+    lock_guard<mutex> lock(queueMutex);
+    return queue.size();
+}
+
+void LLMExecutor::waitIdle() {
+    unique_lock<mutex> lock(queueMutex);
+    idleCV.wait(lock, [&]() { return queue.empty() && !running; });
+}
@@ -0,0 +1,169 @@
+//
+// Created on 2026/10/19.
+//
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Path.h>
+
+#ifdef WD_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#include "LLMQuery/LLMLogSink.h"
+#include "Utils/Tool/Common.h"
+
+bool LLMLogSink::hasZstd() {
+#ifdef WD_HAVE_ZSTD
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool LLMLogSink::open(const string& _dir, bool _compress, uint64_t _maxBytes) {
+    if (_compress && !hasZstd()) {
+        OP << "LLM log compression requested but WrapperDetect was built without zstd\n";
+        return false;
+    }
+    if (error_code ec = sys::fs::create_directories(_dir)) {
+        OP << "cannot create LLM log directory " << _dir << ": " << ec.message() << "\n";
+        return false;
+    }
+    dir = _dir;
+    compress = _compress;
+    maxBytes = _maxBytes;
+    string ext = compress ? ".jsonl.zst" : ".jsonl";
+    SmallString<256> path(dir);
+    sys::path::append(path, "llm_log" + ext);
+    activePath = path.str().str();
+
+    // 只在打开时扫描一次目录，接着已有的轮转序号继续
+    error_code ec;
+    for (sys::fs::directory_iterator it(dir, ec), end; it != end && !ec; it.increment(ec)) {
+        StringRef name = sys::path::filename(it->path());
+        if (!name.consume_front("llm_log.") || !name.consume_back(ext))
+            continue;
+        unsigned n;
+        if (!name.getAsInteger(10, n))
+            rotationNum = max(rotationNum, n);
+    }
+
+    if (!openFile())
+        return false;
+    writer = thread([this]() { writerLoop(); });
+    return true;
+}
+
+bool LLMLogSink::openFile() {
+    // zstd frame可以直接拼接，追加到已有的压缩文件仍可整体解压
+    out.open(activePath, ios::out | ios::app | ios::binary);
+    if (!out.is_open()) {
+        OP << "cannot open LLM log file " << activePath << "\n";
+        return false;
+    }
+    uint64_t size = 0;
+    fileBytes = sys::fs::file_size(activePath, size) ? 0 : size;
+#ifdef WD_HAVE_ZSTD
+    if (compress) {
+        ZSTD_CCtx* cctx = ZSTD_createCCtx();
+        ZSTD_CCtx_setParameter(cctx, ZSTD_c_compressionLevel, ZSTD_CLEVEL_DEFAULT);
+        zstdCtx = cctx;
+    }
+#endif
+    return true;
+}
+
+void LLMLogSink::closeFile() {
+    if (!out.is_open())
+        return;
+#ifdef WD_HAVE_ZSTD
+    if (zstdCtx) {
+        writeData("", true);
+        ZSTD_freeCCtx((ZSTD_CCtx*) zstdCtx);
+        zstdCtx = nullptr;
+    }
+#endif
+    out.close();
+}
+
+void LLMLogSink::rotate() {
+    closeFile();
+    string ext = compress ? ".jsonl.zst" : ".jsonl";
+    SmallString<256> rotated(dir);
+    sys::path::append(rotated, "llm_log." + to_string(++rotationNum) + ext);
+    if (error_code ec = sys::fs::rename(activePath, rotated))
+        OP << "cannot rotate LLM log " << activePath << ": " << ec.message() << "\n";
+    openFile();
+}
+
+void LLMLogSink::writeData(const string& data, bool endFrame) {
+#ifdef WD_HAVE_ZSTD
+    if (zstdCtx) {
+        ZSTD_CCtx* cctx = (ZSTD_CCtx*) zstdCtx;
+        ZSTD_inBuffer input = {data.data(), data.size(), 0};
+        ZSTD_EndDirective mode = endFrame ? ZSTD_e_end : ZSTD_e_flush;
+        vector<char> buffer(ZSTD_CStreamOutSize());
+        size_t remaining;
+        // flush与end模式下返回0表示输入已全部压缩写出
+        do {
+            ZSTD_outBuffer output = {buffer.data(), buffer.size(), 0};
+            remaining = ZSTD_compressStream2(cctx, &output, &input, mode);
+            if (ZSTD_isError(remaining)) {
+                OP << "zstd compression of LLM log failed: " << ZSTD_getErrorName(remaining) << "\n";
+                return;
+            }
+            out.write(buffer.data(), output.pos);
+            fileBytes += output.pos;
+        } while (remaining);
+        out.flush();
+        return;
+    }
+#endif
+    out << data;
+    fileBytes += data.size();
+    out.flush();
+}
+
+void LLMLogSink::writerLoop() {
+    while (true) {
+        deque<json> batch;
+        {
+            unique_lock<mutex> lock(queueMutex);
+            queueCV.wait(lock, [&]() { return stopping || !queue.empty(); });
+            if (queue.empty())
+                return;
+            batch.swap(queue);
+        }
+        string data;
+        for (const json& record: batch) {
+            data += record.dump(-1, ' ', false, json::error_handler_t::replace);
+            data += "\n";
+        }
+        writeData(data);
+        if (maxBytes && fileBytes >= maxBytes)
+            rotate();
+    }
+}
+
+void LLMLogSink::emit(json record) {
+    {
+        lock_guard<mutex> lock(queueMutex);
+        if (stopping)
+            return;
+        queue.push_back(std::move(record));
+        ++recordNum;
+        maxQueueDepth = max(maxQueueDepth, queue.size());
+    }
+    queueCV.notify_one();
+}
+
+void LLMLogSink::close() {
+    if (!writer.joinable())
+        return;
+    {
+        lock_guard<mutex> lock(queueMutex);
+        stopping = true;
+    }
+    queueCV.notify_one();
+    writer.join();
+    closeFile();
+}
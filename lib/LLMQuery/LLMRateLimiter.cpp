@@ -0,0 +1,111 @@
+//
+// Created on 2026/10/19.
+//
+#include "LLMQuery/LLMRateLimiter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+void LLMRateLimiter::configure(double _requestsPerSec, double _tokensPerMin, double _baseBackoffMs) {
+    lock_guard<mutex> lock(limiterMutex);
+    requestsPerSec = _requestsPerSec;
+    tokensPerMin = _tokensPerMin;
+    baseBackoffMs = _baseBackoffMs;
+    // 初始允许1秒的请求突发与1分钟的token预算
+    requestBucket = max(1.0, requestsPerSec);
+    tokenBucket = tokensPerMin;
+    lastRefill = Clock::now();
+}
+
+void LLMRateLimiter::refill(Clock::time_point now) {
+    double elapsedSec = chrono::duration<double>(now - lastRefill).count();
+    lastRefill = now;
+    if (requestsPerSec > 0)
+        requestBucket = min(max(1.0, requestsPerSec), requestBucket + elapsedSec * requestsPerSec);
+    if (tokensPerMin > 0)
+        tokenBucket = min(tokensPerMin, tokenBucket + elapsedSec * tokensPerMin / 60);
+}
+
+bool LLMRateLimiter::sleepFor(double ms, const atomic<bool>* cancelled) {
+    auto deadline = Clock::now() + chrono::duration_cast<Clock::duration>(chrono::duration<double, milli>(ms));
+    while (Clock::now() < deadline) {
+        if (cancelled && cancelled->load())
+            return false;
+        this_thread::sleep_for(min(chrono::duration_cast<Clock::duration>(chrono::milliseconds(100)),
+                                   deadline - Clock::now()));
+    }
+    return true;
+}
+
+bool LLMRateLimiter::acquire(unsigned estimatedTokens, const atomic<bool>* cancelled) {
+    while (true) {
+        double waitMs = 0;
+        bool paused = false;
+        {
+            lock_guard<mutex> lock(limiterMutex);
+            Clock::time_point now = Clock::now();
+            refill(now);
+            // 单个请求的预估超过整个预算时只要求预算用满
+            double neededTokens = min((double) estimatedTokens, tokensPerMin);
+            if (now < pausedUntil) {
+                waitMs = chrono::duration<double, milli>(pausedUntil - now).count();
+                paused = true;
+            }
+            else if (requestsPerSec > 0 && requestBucket < 1)
+                waitMs = (1 - requestBucket) / requestsPerSec * 1000;
+            else if (tokensPerMin > 0 && tokenBucket < neededTokens)
+                waitMs = (neededTokens - tokenBucket) / tokensPerMin * 60000;
+            else {
+                if (requestsPerSec > 0)
+                    requestBucket -= 1;
+                if (tokensPerMin > 0)
+                    tokenBucket -= estimatedTokens;
+                return true;
+            }
+        }
+
+        auto start = Clock::now();
+        bool finished = sleepFor(waitMs, cancelled);
+        double sleptMs = chrono::duration<double, milli>(Clock::now() - start).count();
+        {
+            lock_guard<mutex> lock(limiterMutex);
+            (paused ? retryAfterMs : rateThrottledMs) += sleptMs;
+        }
+        if (!finished)
+            return false;
+    }
+}
+
+void LLMRateLimiter::record(unsigned estimatedTokens, unsigned actualTokens) {
+    lock_guard<mutex> lock(limiterMutex);
+    if (tokensPerMin > 0)
+        tokenBucket -= (double) actualTokens - estimatedTokens;
+}
+
+bool LLMRateLimiter::backoff(unsigned attempt, long retryAfterSec, const atomic<bool>* cancelled) {
+    if (retryAfterSec > 0) {
+        // 服务器过载，暂停所有请求，等待在下一次acquire中进行
+        lock_guard<mutex> lock(limiterMutex);
+        pausedUntil = max(pausedUntil, Clock::now() + chrono::seconds(retryAfterSec));
+        ++retryAfterNum;
+        return true;
+    }
+
+    double waitMs;
+    {
+        lock_guard<mutex> lock(limiterMutex);
+        double capMs = min(maxBackoffMs, baseBackoffMs * pow(2.0, attempt ? attempt - 1 : 0));
+        waitMs = uniform_real_distribution<double>(capMs / 2, capMs)(rng);
+    }
+    auto start = Clock::now();
+    bool finished = sleepFor(waitMs, cancelled);
+    lock_guard<mutex> lock(limiterMutex);
+    backoffMs += chrono::duration<double, milli>(Clock::now() - start).count();
+    return finished;
+}
+
+double LLMRateLimiter::getThrottledMs() {
+    lock_guard<mutex> lock(limiterMutex);
+    return rateThrottledMs + retryAfterMs + backoffMs;
+}
@@ -0,0 +1,72 @@
+//
+// Created on 2026/10/19.
+//
+#include <llvm/ADT/StringExtras.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/SHA1.h>
+
+#include "LLMQuery/LLMResponseCache.h"
+#include "Utils/Tool/Common.h"
+
+bool LLMResponseCache::open(const string& dir) {
+    if (error_code ec = sys::fs::create_directories(dir)) {
+        OP << "cannot create LLM cache directory " << dir << ": " << ec.message() << "\n";
+        return false;
+    }
+    SmallString<256> path(dir);
+    sys::path::append(path, "llm_cache.jsonl");
+
+    // 载入已有记录，跳过写入中断产生的残缺行与不是对象的行
+    ifstream in(path.str().str());
+    string line;
+    while (getline(in, line)) {
+        json entry = json::parse(line, nullptr, false);
+        if (entry.is_discarded() || !entry.is_object() || !entry.contains("key") || !entry["key"].is_string())
+            continue;
+        string key = entry["key"];
+        entries[key] = std::move(entry);
+    }
+    in.close();
+
+    out.open(path.str().str(), ios::out | ios::app);
+    if (!out.is_open()) {
+        OP << "cannot open LLM cache file " << path << "\n";
+        return false;
+    }
+    OP << "loaded " << entries.size() << " cached LLM responses from " << path << "\n";
+    return true;
+}
+
+string LLMResponseCache::getKey(const string& model, const string& SysPrompt, const string& UserPrompt,
+                                float temperature, unsigned voteIdx) {
+    // 序列化为json数组，避免字段拼接产生歧义
+    json fields = {model, SysPrompt, UserPrompt, temperature, voteIdx};
+    string text = fields.dump();
+    return toHex(SHA1::hash(arrayRefFromStringRef(text)), true);
+}
+
+bool LLMResponseCache::lookup(const string& key, json& entry) {
+    lock_guard<mutex> lock(cacheMutex);
+    auto it = entries.find(key);
+    if (it == entries.end()) {
+        ++missNum;
+        return false;
+    }
+    ++hitNum;
+    entry = it->second;
+    return true;
+}
+
+void LLMResponseCache::insert(const string& key, const json& entry) {
+    json record = entry;
+    record["key"] = key;
+    string line = record.dump();
+
+    lock_guard<mutex> lock(cacheMutex);
+    entries[key] = std::move(record);
+    if (out.is_open()) {
+        out << line << "\n";
+        out.flush();
+    }
+}
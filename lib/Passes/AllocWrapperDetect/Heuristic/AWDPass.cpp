@@ -10,16 +10,8 @@
 #include "Passes/AllocWrapperDetect/Heuristic/AWDPass.h"
 
 bool AWDPass::doInitialization(Module* M) {
-    // collect internal defined function names
-    for (Function &F : *M) {
-        if (F.isDeclaration())
-            continue;
-        if (allocFuncsNames.count(F.getName().str()))
-            allocFuncsNames.erase(F.getName().str());
-    }
-
     OP << "alloc function include:\n";
-    for (const string& funcName: allocFuncsNames)
+    for (const string& funcName: Ctx->APIs.allocNames)
         OP << funcName << " , ";
     OP << "\n";
 
@@ -28,21 +20,19 @@ bool AWDPass::doInitialization(Module* M) {
         Function *F = &*f;
         if (F->isDeclaration())
             continue;
-        for (inst_iterator i = inst_begin(F), e = inst_end(F); i != e; ++i) {
+        for (CallBase* CI: Ctx->Facts.callsites(F)) {
             // if call to malloc
-            if (CallBase* CI = dyn_cast<CallBase>(&*i)) {
-                Function* CF = CommonUtil::getBaseFunction(CI->getCalledOperand());
-                if (CF && allocFuncsNames.count(CF->getName().str())) {
-                    baseAllocCalls.insert(CI);
-                    continue;
-                }
-                // indirect-call
-                if (CI->isIndirectCall()) {
-                    for (Function* callee: Ctx->Callees[CI]) {
-                        if (allocFuncsNames.count(callee->getName().str())) {
-                            baseAllocCalls.insert(CI);
-                            break;
-                        }
+            Function* CF = CommonUtil::getBaseFunction(CI->getCalledOperand());
+            if (Ctx->APIs.isAlloc(CF)) {
+                baseAllocCalls.insert(CI);
+                continue;
+            }
+            // indirect-call
+            if (CI->isIndirectCall()) {
+                for (Function* callee: Ctx->CG.callees(CI)) {
+                    if (Ctx->APIs.isAlloc(callee)) {
+                        baseAllocCalls.insert(CI);
+                        break;
                     }
                 }
             }
@@ -54,7 +44,10 @@ bool AWDPass::doInitialization(Module* M) {
 
 // find new wrapper, return true
 bool AWDPass::doModulePass(Module* M) {
+    buildArgRetSummaries();
     set<CallBase*> visitedCallInsts;
+    // wrappers in discovery order
+    vector<Function*> newWrappers;
     for (CallBase* baseAllocCI: baseAllocCalls) {
         queue<CallBase*> worklist;
         worklist.push(baseAllocCI);
@@ -72,13 +65,17 @@ bool AWDPass::doModulePass(Module* M) {
                 // it has not been processed yet
                 if (!AllocWrappers.count(curF)) {
                     AllocWrappers.insert(curF);
+                    newWrappers.push_back(curF);
                     // check whether the caller could be returned in that function
-                    for (CallBase* caller: Ctx->Callers[curF])
+                    for (CallBase* caller: Ctx->CG.callerCallsites(curF))
                         worklist.push(caller);
                 }
             }
         }
     }
+    // a later alloc call may still be returned by a wrapper found earlier, calls are final only here
+    for (Function* F: newWrappers)
+        emitWrapper(F);
     return false;
 }
 
@@ -96,61 +93,291 @@ bool AWDPass::doFinalization(Module* M) {
     return false;
 }
 
+void AWDPass::emitWrapper(Function* F) {
+    Ctx->WrapperStream.emit(ID, F, callInWrappers[F], Ctx->CG);
+}
+
 // does not trace along indirect value flow, consider flow to
 bool AWDPass::traceValueFlow(Value* V, set<Value*>& visitedValues) {
+    // values defined in a function are answered by the per-function cache
+    if (Instruction* I = dyn_cast<Instruction>(V))
+        return reachReturn(I);
+
     if (visitedValues.count(V))
         return false;
     visitedValues.insert(V);
+    if (flowToReturnDirectly(V))
+        return true;
     for (User* U: V->users()) {
-        // if (p = malloc()) --> return p
-        if (isa<ReturnInst>(U))
-            return true;
-
         // only need one user flow to return
         // if "p1 = malloc(), ... p = phi(p1, p2), ... return p", still return true
         // phi is cycle, lead to recursive
-        else if (isa<BitCastInst>(U) || isa<PtrToIntInst>(U) || isa<IntToPtrInst>(U)
+        if (isa<BitCastInst>(U) || isa<PtrToIntInst>(U) || isa<IntToPtrInst>(U)
                 || isa<BitCastOperator>(U) || isa<PtrToIntOperator>(U) || isa<PHINode>(U)) {
             if (traceValueFlow(U, visitedValues))
                 return true;
         }
 
+        // p = memcpy(p1, ...) same as p = p1
         else if (CallBase* CI = dyn_cast<CallBase>(U)) {
             Function* CF = CommonUtil::getBaseFunction(CI->getCalledOperand());
-            if (CF) {
-                // p = memcpy(p1, ...) same as p = p1
-                if (copyAPI.count(CF->getName().str())) {
-                    if (CI->getNumOperands() > 2 && CI->getArgOperand(0) == V)
-                        if (traceValueFlow(CI, visitedValues))
-                            return true;
-                }
-                // p = func(p1, ...), p1 reach return val
-                else if (!CF->isDeclaration() && !CF->getReturnType()->isVoidTy()) {
-                    unsigned argNo = -1;
-                    for (unsigned i = 0; i < CI->getNumOperands() - 1; ++i)
-                        if (CI->getArgOperand(i) == V) {
-                            argNo = i;
-                            break;
-                        }
-
-                    if (argNo != -1 && argNo < CF->arg_size() && checkFuncArgRet(CF, argNo))
-                        return true;
+            if (Ctx->APIs.isCopy(CF) && CI->getNumOperands() > 2 && CI->getArgOperand(0) == V)
+                if (traceValueFlow(CI, visitedValues))
+                    return true;
+        }
+    }
+    return false;
+}
+
+bool AWDPass::flowToReturnDirectly(Value* V) {
+    for (User* U: V->users()) {
+        // if (p = malloc()) --> return p
+        if (isa<ReturnInst>(U))
+            return true;
+
+        // p = func(p1, ...), p1 reach return val
+        if (CallBase* CI = dyn_cast<CallBase>(U)) {
+            Function* CF = CommonUtil::getBaseFunction(CI->getCalledOperand());
+            if (!CF || Ctx->APIs.isCopy(CF))
+                continue;
+            if (CF->isDeclaration() || CF->getReturnType()->isVoidTy())
+                continue;
+            unsigned argNo = -1;
+            for (unsigned i = 0; i < CI->getNumOperands() - 1; ++i)
+                if (CI->getArgOperand(i) == V) {
+                    argNo = i;
+                    break;
                 }
-            }
+
+            if (argNo != -1 && argNo < CF->arg_size() && checkFuncArgRet(CF, argNo))
+                return true;
         }
     }
     return false;
 }
 
+bool AWDPass::reachReturn(Instruction* I) {
+    Function* F = I->getFunction();
+    {
+        lock_guard<mutex> lock(Ctx->FlowCache.returnReachMutex);
+        auto it = Ctx->FlowCache.returnReachCache.find(F);
+        if (it != Ctx->FlowCache.returnReachCache.end())
+            return it->second.count(I);
+    }
+
+    // SCCs analyzed concurrently may build the same function twice, the results are identical
+    set<Instruction*> reached;
+    collectReturnReach(F, reached);
+    lock_guard<mutex> lock(Ctx->FlowCache.returnReachMutex);
+    return Ctx->FlowCache.returnReachCache.emplace(F, std::move(reached)).first->second.count(I);
+}
+
+// a value reaches return if it is used by return or returning call, or one of its copies reaches return.
+// propagate backward from such values along copy edges: cast, phi and copy API
+void AWDPass::collectReturnReach(Function* F, set<Instruction*>& reached) {
+    queue<Instruction*> worklist;
+    auto pushOperand = [&worklist](Value* V) {
+        if (Instruction* I = dyn_cast<Instruction>(V))
+            worklist.push(I);
+    };
+
+    // same as flowToReturnDirectly, but start from returns and callsites in the fact table
+    for (ReturnInst* RI: Ctx->Facts.returns(F))
+        if (RI->getReturnValue())
+            pushOperand(RI->getReturnValue());
+    for (CallBase* CI: Ctx->Facts.callsites(F)) {
+        Function* CF = CommonUtil::getBaseFunction(CI->getCalledOperand());
+        if (!CF || Ctx->APIs.isCopy(CF))
+            continue;
+        if (CF->isDeclaration() || CF->getReturnType()->isVoidTy())
+            continue;
+        // a value passed more than once is matched with its first arg
+        for (unsigned argNo: getFuncArgRets(CF)) {
+            if (argNo >= CI->arg_size())
+                continue;
+            Value* V = CI->getArgOperand(argNo);
+            if (find(CI->arg_begin(), CI->arg_begin() + argNo, V) == CI->arg_begin() + argNo)
+                pushOperand(V);
+        }
+    }
+
+    while (!worklist.empty()) {
+        Instruction* I = worklist.front();
+        worklist.pop();
+        if (reached.count(I))
+            continue;
+        reached.insert(I);
+
+        if (PHINode* PN = dyn_cast<PHINode>(I)) {
+            for (Value* incoming: PN->incoming_values())
+                pushOperand(incoming);
+        }
+        else if (isa<BitCastInst>(I) || isa<PtrToIntInst>(I) || isa<IntToPtrInst>(I))
+            pushOperand(I->getOperand(0));
+        else if (CallBase* CI = dyn_cast<CallBase>(I)) {
+            Function* CF = CommonUtil::getBaseFunction(CI->getCalledOperand());
+            if (Ctx->APIs.isCopy(CF) && CI->getNumOperands() > 2)
+                pushOperand(CI->getArgOperand(0));
+        }
+    }
+}
+
 bool AWDPass::checkFuncArgRet(Function* F, unsigned argNo) {
-    Argument* arg = F->getArg(argNo);
-    for (inst_iterator i = inst_begin(F), e = inst_end(F); i != e; ++i) {
-        Instruction *I = &*i;
-        if (ReturnInst* retInst = dyn_cast<ReturnInst>(I)) {
-            if (retInst->getReturnValue() != arg)
-                return false;
+    if (argNo >= 64)
+        return false;
+    auto it = Ctx->FlowCache.argRetSummaries.find(F);
+    return it != Ctx->FlowCache.argRetSummaries.end() && (it->second >> argNo) & 1;
+}
+
+set<unsigned> AWDPass::getFuncArgRets(Function* F) {
+    set<unsigned> argNos;
+    for (unsigned argNo = 0; argNo < F->arg_size(); ++argNo) {
+        if (checkFuncArgRet(F, argNo))
+            argNos.insert(argNo);
+    }
+    return argNos;
+}
+
+static uint64_t allArgsMask(Function* F) {
+    return F->arg_size() >= 64 ? ~0ULL : (1ULL << F->arg_size()) - 1;
+}
+
+void AWDPass::buildArgRetSummaries() {
+    if (Ctx->FlowCache.argRetSummariesBuilt)
+        return;
+    Ctx->FlowCache.argRetSummariesBuilt = true;
+
+    // start from all args and shrink to the greatest fixpoint, so recursion like
+    // "f(p) { if (...) return f(p); return p; }" still returns p
+    auto initSummary = [this](Function* F) {
+        bool summarized = !F->isDeclaration() && !F->getReturnType()->isVoidTy();
+        Ctx->FlowCache.argRetSummaries[F] = summarized ? allArgsMask(F) : 0;
+    };
+
+    for (const vector<Function*>& scc: Ctx->SCC) {
+        for (Function* F: scc)
+            initSummary(F);
+        bool changed;
+        do {
+            changed = false;
+            for (Function* F: scc)
+                if (summarizeArgRet(F))
+                    changed = true;
+        } while (changed);
+    }
+
+    // functions not on any call edge
+    for (auto& item: Ctx->Modules) {
+        for (Function& F: *item.first) {
+            if (Ctx->FlowCache.argRetSummaries.count(&F))
+                continue;
+            initSummary(&F);
+            summarizeArgRet(&F);
         }
     }
-    func2args[F].insert(argNo);
-    return true;
-}
\ No newline at end of file
+}
+
+// arg bits of V computed from the masks of the values it copies from
+uint64_t AWDPass::evalArgMask(Value* V, const DenseMap<Value*, uint64_t>& masks) {
+    auto maskOf = [&masks](Value* op) {
+        auto it = masks.find(op);
+        return it == masks.end() ? 0 : it->second;
+    };
+
+    if (Argument* arg = dyn_cast<Argument>(V))
+        return arg->getArgNo() < 64 ? 1ULL << arg->getArgNo() : 0;
+
+    else if (isa<BitCastInst>(V) || isa<PtrToIntInst>(V) || isa<IntToPtrInst>(V)
+            || isa<BitCastOperator>(V) || isa<PtrToIntOperator>(V))
+        return maskOf(cast<User>(V)->getOperand(0));
+
+    // phi always equals an arg only if every incoming value does
+    else if (PHINode* PN = dyn_cast<PHINode>(V)) {
+        uint64_t mask = ~0ULL;
+        for (Value* incoming: PN->incoming_values())
+            mask &= maskOf(incoming);
+        return mask;
+    }
+
+    else if (CallBase* CI = dyn_cast<CallBase>(V)) {
+        Function* CF = CommonUtil::getBaseFunction(CI->getCalledOperand());
+        if (!CF)
+            return 0;
+        // p = memcpy(p1, ...) same as p = p1
+        if (Ctx->APIs.isCopy(CF))
+            return CI->getNumOperands() > 2 ? maskOf(CI->getArgOperand(0)) : 0;
+        // p = func(p1, ...) and func returns its arg p1
+        uint64_t mask = 0;
+        for (unsigned argNo: getFuncArgRets(CF))
+            if (argNo < CI->arg_size())
+                mask |= maskOf(CI->getArgOperand(argNo));
+        return mask;
+    }
+    return 0;
+}
+
+bool AWDPass::summarizeArgRet(Function* F) {
+    uint64_t oldSummary = Ctx->FlowCache.argRetSummaries[F];
+    if (!oldSummary)
+        return false;
+
+    // collect values that return values are copied from
+    vector<ReturnInst*> rets;
+    vector<Value*> values;
+    DenseMap<Value*, uint64_t> masks;
+    queue<Value*> worklist;
+    for (ReturnInst* RI: Ctx->Facts.returns(F)) {
+        rets.push_back(RI);
+        worklist.push(RI->getReturnValue());
+    }
+
+    while (!worklist.empty()) {
+        Value* V = worklist.front();
+        worklist.pop();
+        if (!masks.insert(make_pair(V, ~0ULL)).second)
+            continue;
+        values.push_back(V);
+
+        if (isa<BitCastInst>(V) || isa<PtrToIntInst>(V) || isa<IntToPtrInst>(V)
+                || isa<BitCastOperator>(V) || isa<PtrToIntOperator>(V))
+            worklist.push(cast<User>(V)->getOperand(0));
+        else if (PHINode* PN = dyn_cast<PHINode>(V)) {
+            for (Value* incoming: PN->incoming_values())
+                worklist.push(incoming);
+        }
+        else if (CallBase* CI = dyn_cast<CallBase>(V)) {
+            Function* CF = CommonUtil::getBaseFunction(CI->getCalledOperand());
+            if (!CF)
+                continue;
+            if (Ctx->APIs.isCopy(CF)) {
+                if (CI->getNumOperands() > 2)
+                    worklist.push(CI->getArgOperand(0));
+            }
+            else {
+                for (unsigned argNo: getFuncArgRets(CF))
+                    if (argNo < CI->arg_size())
+                        worklist.push(CI->getArgOperand(argNo));
+            }
+        }
+    }
+
+    // masks only shrink, iterate until stable
+    bool changed;
+    do {
+        changed = false;
+        for (Value* V: values) {
+            uint64_t mask = evalArgMask(V, masks);
+            if (mask != masks[V]) {
+                masks[V] = mask;
+                changed = true;
+            }
+        }
+    } while (changed);
+
+    // every return value must come from the arg
+    uint64_t summary = oldSummary;
+    for (ReturnInst* RI: rets)
+        summary &= masks[RI->getReturnValue()];
+    Ctx->FlowCache.argRetSummaries[F] = summary;
+    return summary != oldSummary;
+}
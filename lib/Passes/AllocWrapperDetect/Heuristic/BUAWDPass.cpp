@@ -5,38 +5,27 @@
 #include <llvm/IR/Instructions.h>
 
 #include "Passes/AllocWrapperDetect/Heuristic/BUAWDPass.h"
-#include "Utils/Basic/Tarjan.h"
 
 bool BUAWDPass::doInitialization(Module* M) {
-    // collect internal defined function names
-    for (Function &F : *M) {
-        if (F.isDeclaration())
-            continue;
-        if (allocFuncsNames.count(F.getName().str()))
-            allocFuncsNames.erase(F.getName().str());
-    }
-
     // collect malloc sources
     for (auto &f : *M) {
         Function *F = &f;
         if (F->isDeclaration())
             continue;
-        for (inst_iterator i = inst_begin(F), e = inst_end(F); i != e; ++i) {
+        for (CallBase* CI: Ctx->Facts.callsites(F)) {
             // if call to malloc
-            if (CallBase* CI = dyn_cast<CallBase>(&*i)) {
-                Function* CF = CommonUtil::getBaseFunction(CI->getCalledOperand());
-                if (CF && allocFuncsNames.count(CF->getName().str())) {
-                    function2AllocCalls[F].insert(CI);
-                    continue;
-                }
+            Function* CF = CommonUtil::getBaseFunction(CI->getCalledOperand());
+            if (Ctx->APIs.isAlloc(CF)) {
+                function2AllocCalls[F].insert(CI);
+                continue;
+            }
 
-                // indirect-call
-                if (CI->isIndirectCall()) {
-                    for (Function* callee: Ctx->Callees[CI]) {
-                        if (allocFuncsNames.count(callee->getName().str())) {
-                            function2AllocCalls[F].insert(CI);
-                            break;
-                        }
+            // indirect-call
+            if (CI->isIndirectCall()) {
+                for (Function* callee: Ctx->CG.callees(CI)) {
+                    if (Ctx->APIs.isAlloc(callee)) {
+                        function2AllocCalls[F].insert(CI);
+                        break;
                     }
                 }
             }
@@ -46,10 +35,10 @@ bool BUAWDPass::doInitialization(Module* M) {
 }
 
 bool BUAWDPass::doModulePass(Module* M) {
-    Tarjan tarjan(Ctx->CallMaps);
-    tarjan.getSCC(Ctx->SCC);
-
+    buildArgRetSummaries();
     for (vector<Function*> sc: Ctx->SCC) {
+        // wrappers of this SCC in discovery order
+        vector<Function*> newWrappers;
         bool changed;
         do {
             changed = false;
@@ -65,8 +54,9 @@ bool BUAWDPass::doModulePass(Module* M) {
                             }
                             if (!AllocWrappers.count(F)) {
                                 AllocWrappers.insert(F);
+                                newWrappers.push_back(F);
                                 changed = true;
-                                for (CallBase* caller: Ctx->Callers[F])
+                                for (CallBase* caller: Ctx->CG.callerCallsites(F))
                                     function2AllocCalls[caller->getFunction()].insert(caller);
                             }
                         }
@@ -74,6 +64,9 @@ bool BUAWDPass::doModulePass(Module* M) {
                 }
             }
         } while (changed);
+        // alloc calls of the SCC only change while it is analyzed
+        for (Function* F: newWrappers)
+            emitWrapper(F);
     }
     return false;
 }
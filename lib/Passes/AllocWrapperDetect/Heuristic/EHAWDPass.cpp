@@ -8,184 +8,180 @@
 #include <queue>
 
 #include "Passes/AllocWrapperDetect/Heuristic/EHAWDPass.h"
-#include "Utils/Basic/Tarjan.h"
 
+// side-effect only propagates bottom-up, so each SCC is summarized once after its callee SCCs:
+// members with their own side-effect or calling side-effect functions of lower SCCs are seeds,
+// then side-effect is promoted to callers inside the SCC in one traversal.
 void EHAWDPass::identifySideEffectFunctions() {
+    if (sideEffectAnalyzed)
+        return;
+    sideEffectAnalyzed = true;
     OP << "LLM-enhanced Pass: analyze side-effect function start\n";
 
-    for (vector<Function*> scc: Ctx->SCC) {
-        set<Function*> sccSet(scc.begin(), scc.end());
-        for (Function* F: scc) {
-            if (F->isDeclaration())
+    for (unsigned sccIdx = 0; sccIdx < Ctx->SCC.size(); ++sccIdx) {
+        const vector<Function*>& scc = Ctx->SCC[sccIdx];
+        // members are not summarized yet, so only side-effect of lower SCCs is seen here
+        vector<unsigned> seedKinds(scc.size(), 0);
+        for (unsigned i = 0; i < scc.size(); ++i)
+            if (!scc[i]->isDeclaration())
+                seedKinds[i] = scanSideEffects(scc[i], nullptr);
+
+        queue<Function*> worklist;
+        for (unsigned i = 0; i < scc.size(); ++i) {
+            if (!seedKinds[i])
                 continue;
+            sideEffectSummaries[scc[i]].kinds |= seedKinds[i];
+            worklist.push(scc[i]);
+        }
 
-            // traversing every instruction
-            for (inst_iterator i = inst_begin(F), e = inst_end(F); i != e; ++i) {
-                if (StoreInst* SI = dyn_cast<StoreInst>(&*i)) {
-                    // store non-null pointer data should be conservatively deemed as side-effect
-                    if (analyzeStore(SI))
-                        func2SideEffectOps[F].insert(make_pair(SI, SideEffectType::Store));
-                }
+        // for side-effect function, promote side-effect to its caller in current SCC.
+        set<Function*> visited;
+        while (!worklist.empty()) {
+            Function* curF = worklist.front();
+            worklist.pop();
+            // caller map is constant so we don't need to visit a Function twice.
+            if (visited.count(curF))
+                continue;
+            visited.insert(curF);
 
-                else if (CallBase* CI = dyn_cast<CallBase>(&*i)) {
-                    Function* Callee = CommonUtil::getBaseFunction(CI->getCalledOperand());
-                    // recursive call, skip
-                    if (Callee == F)
-                        continue;
-                    // call sensitive API
-                    if (Callee && Callee->isDeclaration()) {
-                        if (sensiAPI.count(Callee->getName().str()) || deallocAPI.count(Callee->getName().str()))
-                            func2SideEffectOps[F].insert(make_pair(CI, SideEffectType::SysCall));
-
-                            // if copy cal like: memcpy(dst, src). check whether dst is complex pointer
-                        else if (copyAPI.count(Callee->getName().str())) {
-                            // dst could store other pointer
-                            if (analyzeCopyArg(CI->getArgOperand(0)) || analyzeCopyArg(CI->getArgOperand(1)))
-                                func2SideEffectOps[F].insert(make_pair(CI, SideEffectType::Store));
-                        }
-                        continue;
-                    }
+            for (CallBase* CI: Ctx->CG.callerCallsites(curF)) {
+                Function* CallerF = CI->getFunction();
+                if (Ctx->SCCDAG.getSCCIndex(Ctx->CG, CallerF) != sccIdx)
+                    continue;
+                sideEffectSummaries[CallerF].kinds |= 1 << SideEffectType::Call;
+                if (!visited.count(CallerF))
+                    worklist.push(CallerF);
+            }
+        }
+    }
 
-                    // multiple potential callees， if one is side-effect function.
-                    // then this function is side-effect.
-                    for (Function* CF: Ctx->Callees[CI]) {
-                        if (func2SideEffectOps.count(CF)) {
-                            func2SideEffectOps[F].insert(make_pair(CI, SideEffectType::Call));
-                            break;
-                        }
-                    }
+    OP << "LLM-enhanced Pass: analyze side-effect function done\n";
+}
+
+unsigned EHAWDPass::scanSideEffects(Function* F, SideEffectOps* ops) {
+    unsigned kinds = 0;
+    auto record = [&kinds, ops](Instruction* I, SideEffectType type) {
+        kinds |= 1 << type;
+        if (ops)
+            ops->push_back(make_pair(I, type));
+    };
+    unsigned sccIdx = Ctx->SCCDAG.getSCCIndex(Ctx->CG, F);
+
+    for (StoreInst* SI: Ctx->Facts.stores(F)) {
+        // store non-null pointer data should be conservatively deemed as side-effect
+        if (analyzeStore(SI))
+            record(SI, SideEffectType::Store);
+    }
+
+    for (CallBase* CI: Ctx->Facts.callsites(F)) {
+        Function* Callee = CommonUtil::getBaseFunction(CI->getCalledOperand());
+        bool sideEffectCall = false;
+        // recursive call is only side-effect when F is promoted inside its SCC
+        if (Callee != F) {
+            // call sensitive API
+            if (Callee && Callee->isDeclaration()) {
+                if (Ctx->APIs.isSensitive(Callee) || Ctx->APIs.isDealloc(Callee))
+                    record(CI, SideEffectType::SysCall);
+
+                // if copy cal like: memcpy(dst, src). check whether dst is complex pointer
+                else if (Ctx->APIs.isCopy(Callee)) {
+                    // dst could store other pointer
+                    if (analyzeCopyArg(CI->getArgOperand(0)) || analyzeCopyArg(CI->getArgOperand(1)))
+                        record(CI, SideEffectType::Store);
                 }
             }
 
-            // for side-effect function F, promote side-effect to its caller in current SCC.
-            if (func2SideEffectOps.count(F)) {
-                queue<Function*> worklist;
-                worklist.push(F);
-                set<Function*> visited;
-                while (!worklist.empty()) {
-                    Function* curF = worklist.front();
-                    worklist.pop();
-                    // caller map is constant so we don't need to visit a Function twice.
-                    if (visited.count(curF))
-                        continue;
-                    visited.insert(curF);
-
-                    // all caller instruction
-                    for (CallBase* CI: Ctx->Callers[curF]) {
-                        Function* CallerF = CI->getFunction();
-                        // if CallerF not in current SCC
-                        if (!sccSet.count(CallerF))
-                            continue;
-                        pair<Instruction*, SideEffectType> item = make_pair(CI, SideEffectType::Call);
-                        // if CI has already been recorded
-                        if (func2SideEffectOps[CallerF].count(item))
-                            continue;
-
-                        func2SideEffectOps[CallerF].insert(item);
-                        worklist.push(CallerF);
+            // multiple potential callees， if one is side-effect function.
+            // then this function is side-effect.
+            else {
+                for (Function* CF: Ctx->CG.callees(CI)) {
+                    if (hasSideEffect(CF)) {
+                        sideEffectCall = true;
+                        break;
                     }
                 }
             }
         }
 
+        // call to a side-effect function in the same SCC
+        if (!sideEffectCall && sccIdx != CallGraphSCC::InvalidSCC) {
+            for (Function* CF: Ctx->CG.callees(CI)) {
+                if (hasSideEffect(CF) && Ctx->SCCDAG.getSCCIndex(Ctx->CG, CF) == sccIdx) {
+                    sideEffectCall = true;
+                    break;
+                }
+            }
+        }
+        if (sideEffectCall)
+            record(CI, SideEffectType::Call);
     }
+    return kinds;
+}
 
-    OP << "LLM-enhanced Pass: analyze side-effect function done\n";
+const SideEffectOps* EHAWDPass::getSideEffectOps(Function* F) {
+    auto it = sideEffectSummaries.find(F);
+    if (it == sideEffectSummaries.end())
+        return nullptr;
+    // wrapper candidates of concurrent SCCs may ask for the same function
+    lock_guard<mutex> lock(sideEffectOpsMutex);
+    SideEffectSummary& summary = it->second;
+    if (!summary.materialized) {
+        scanSideEffects(F, &summary.ops);
+        summary.materialized = true;
+    }
+    return &summary.ops;
 }
 
 bool EHAWDPass::doModulePass(Module* M) {
-    // analyze strong connected component
-    Tarjan tarjan(Ctx->CallMaps);
-    tarjan.getSCC(Ctx->SCC);
     // first identify side-effect functions
     identifySideEffectFunctions();
     // identify simple allocation wrappers
-    for (const vector<Function*>& sc: Ctx->SCC) {
-        queue<Function*> worklist;
-        set<Function*> inWorklist;
-
-        for (Function* F : sc) {
-            worklist.push(F);
-            inWorklist.insert(F);
-        }
-
-        while (!worklist.empty()) {
-            Function* F = worklist.front();
-            worklist.pop();
-            inWorklist.erase(F);
-
-            bool isAlloc = false;
-            bool everyAllocReturned = true;
-            set<CallBase*> visitedAllocCalls;
-            checkWhetherAlloc(F, isAlloc, everyAllocReturned, visitedAllocCalls);
-            if (!isAlloc || !everyAllocReturned)
-                continue;
-
-            set<CallBase*> potentialAllocs;
-            potentialAllocs.insert(visitedAllocCalls.begin(), visitedAllocCalls.end());
-            processPotentialAllocs(F, potentialAllocs);
-
-            // determine whether F could be a simple alloc function
-            bool simpleRet = true;
-            bool operateGlob = checkSimpleAlloc(F, simpleRet, potentialAllocs);
-
-            if (!simpleRet)
-                continue;
+    detectWrappers();
+    return false;
+}
 
-            // if F has side-effect, check whether side-effect affect
-            if (func2SideEffectOps.count(F)) {
-                // check whether current function load from global variable
-                // count side-effect instructions
-                bool sideEffectIgnorable = true;
-                for (pair<Instruction*, SideEffectType> sideEffect: func2SideEffectOps[F]) {
-                    if (sideEffect.second == SideEffectType::Store) {
-                        sideEffectIgnorable = false;
-                        break;
-                    }
-                    CallBase* CI = dyn_cast<CallBase>(sideEffect.first);
-                    if (!potentialAllocs.count(CI)) {
-                        bool allArgSimpleType = !isComplexType(CI->getType());
-                        for (unsigned i = 0; i < CI->getNumOperands() - 1; ++i) {
-                            if (isComplexType(CI->getArgOperand(i)->getType())) {
-                                allArgSimpleType = false;
-                                break;
-                            }
-                        }
-                        if (!allArgSimpleType || operateGlob) {
-                            sideEffectIgnorable = false;
-                            break;
-                        }
-                    }
+// if F has side-effect, check whether side-effect affect
+bool EHAWDPass::confirmWrapper(Function* F, SCCTask& task, set<CallBase*>& visitedAllocCalls,
+                               set<CallBase*>& potentialAllocs, bool operateGlob) {
+    auto it = sideEffectSummaries.find(F);
+    if (it == sideEffectSummaries.end())
+        return true;
+    // store side-effect can not be ignored
+    if (it->second.kinds & (1 << SideEffectType::Store))
+        return false;
+
+    // check whether current function load from global variable
+    // count side-effect instructions
+    for (const pair<Instruction*, SideEffectType>& sideEffect: *getSideEffectOps(F)) {
+        CallBase* CI = dyn_cast<CallBase>(sideEffect.first);
+        if (!potentialAllocs.count(CI)) {
+            bool allArgSimpleType = !isComplexType(CI->getType());
+            for (unsigned i = 0; i < CI->getNumOperands() - 1; ++i) {
+                if (isComplexType(CI->getArgOperand(i)->getType())) {
+                    allArgSimpleType = false;
+                    break;
                 }
-
-                if (!sideEffectIgnorable)
-                    continue;
             }
-
-            // F is simple function wrapper
-            // found new simple allocation wrapper, push upper caller to worklist
-            promoteToCaller(F, visitedAllocCalls, worklist, inWorklist);
+            if (!allArgSimpleType || operateGlob)
+                return false;
         }
     }
-    return false;
+    return true;
 }
 
 bool EHAWDPass::checkSimpleAlloc(Function* F, bool &simpleRet, set<CallBase*>& potentialAllocs) {
     bool operateGlob = false;
-    for (inst_iterator i = inst_begin(F), e = inst_end(F); i != e; ++i) {
-        Instruction* I = &*i;
-        if (ReturnInst* RI = dyn_cast<ReturnInst>(I)) {
-            if (!analyzeReturn(RI, potentialAllocs)) {
-                simpleRet = false;
-                break;
-            }
+    for (ReturnInst* RI: Ctx->Facts.returns(F)) {
+        if (!analyzeReturn(RI, potentialAllocs)) {
+            simpleRet = false;
+            break;
         }
+    }
 
-        for (unsigned ii = 0; ii < I->getNumOperands(); ++ii)
-            if (GlobalVariable* GV = dyn_cast<GlobalVariable>(I->getOperand(ii))) {
-                if (GV->getType()->isPointerTy() && isComplexType(GV->getType()->getNonOpaquePointerElementType()))
-                    operateGlob = true;
-            }
+    for (const pair<Instruction*, GlobalVariable*>& globalUse: Ctx->Facts.globalUses(F)) {
+        GlobalVariable* GV = globalUse.second;
+        if (GV->getType()->isPointerTy() && isComplexType(GV->getType()->getNonOpaquePointerElementType()))
+            operateGlob = true;
     }
     return operateGlob;
 }
\ No newline at end of file
@@ -6,42 +6,34 @@
 #include <llvm/IR/Constants.h>
 #include <llvm/IR/Operator.h>
 
+#include <condition_variable>
 #include <queue>
+#include <thread>
 
 #include "Passes/AllocWrapperDetect/Heuristic/HAWDPass.h"
-#include "Utils/Basic/Tarjan.h"
+#include "Utils/Tool/Parallel.h"
 
 
 bool HAWDPass::doInitialization(Module* M) {
-    // collect internal defined function names
-    for (Function &F : *M) {
-        if (F.isDeclaration())
-            continue;
-        if (allocFuncsNames.count(F.getName().str()))
-            allocFuncsNames.erase(F.getName().str());
-    }
-
     // collect malloc sources
     for (auto &f : *M) {
         Function *F = &f;
         if (F->isDeclaration())
             continue;
-        for (inst_iterator i = inst_begin(F), e = inst_end(F); i != e; ++i) {
+        for (CallBase* CI: Ctx->Facts.callsites(F)) {
             // if call to malloc
-            if (CallBase* CI = dyn_cast<CallBase>(&*i)) {
-                Function* CF = CommonUtil::getBaseFunction(CI->getCalledOperand());
-                if (CF && allocFuncsNames.count(CF->getName().str())) {
-                    function2AllocCalls[F].insert(CI);
-                    continue;
-                }
+            Function* CF = CommonUtil::getBaseFunction(CI->getCalledOperand());
+            if (Ctx->APIs.isAlloc(CF)) {
+                function2AllocCalls[F].insert(CI);
+                continue;
+            }
 
-                // indirect-call
-                if (CI->isIndirectCall()) {
-                    for (Function* callee: Ctx->Callees[CI]) {
-                        if (allocFuncsNames.count(callee->getName().str())) {
-                            function2AllocCalls[F].insert(CI);
-                            break;
-                        }
+            // indirect-call
+            if (CI->isIndirectCall()) {
+                for (Function* callee: Ctx->CG.callees(CI)) {
+                    if (Ctx->APIs.isAlloc(callee)) {
+                        function2AllocCalls[F].insert(CI);
+                        break;
                     }
                 }
             }
@@ -53,51 +45,249 @@ bool HAWDPass::doInitialization(Module* M) {
 
 // we deem pointer type data store cause side-effect cause it brings hard-predicted alias relationships
 bool HAWDPass::doModulePass(Module* M) {
-    // analyze strong connected component
-    Tarjan tarjan(Ctx->CallMaps);
-    tarjan.getSCC(Ctx->SCC);
     // first identify side-effect functions
     identifySideEffectFunctions();
 
     // identify simple allocation wrappers
-    for (const vector<Function*>& sc: Ctx->SCC) {
-        queue<Function*> worklist;
-        set<Function*> inWorklist;
+    detectWrappers();
+    return false;
+}
 
-        for (Function* F: sc) {
-            if (sideEffectFuncs.count(F))
-                continue;
-            worklist.push(F);
-            inWorklist.insert(F);
+// SCCs in the same level never call each other, so they only depend on wrappers committed by lower levels.
+// new wrappers are promoted to callers outside the SCC after all tasks of the level are committed,
+// which makes the result independent of the number of threads.
+void HAWDPass::detectWrappers() {
+    buildArgRetSummaries();
+    pendingSeeds.clear();
+    for (const vector<unsigned>& level: Ctx->SCCDAG.levelSCCs) {
+        vector<SCCTask> tasks(level.size());
+        auto runTask = [&](size_t i) {
+            tasks[i].sccIdx = level[i];
+            runSCCTask(tasks[i]);
+        };
+        if (concurrentSCCs())
+            parallelFor(level.size(), runTask);
+        else {
+            for (size_t i = 0; i < level.size(); ++i)
+                runTask(i);
         }
 
-        while (!worklist.empty()) {
-            Function* F = worklist.front();
-            worklist.pop();
-            inWorklist.erase(F);
+        for (SCCTask& task: tasks)
+            commitTask(task);
 
-            bool isAlloc = false;
-            bool everyAllocReturned = true;
-            set<CallBase*> visitedAllocCalls;
-            checkWhetherAlloc(F, isAlloc, everyAllocReturned, visitedAllocCalls);
-            if (!isAlloc || !everyAllocReturned)
-                continue;
+        // promote new wrappers to callers in upper levels
+        for (SCCTask& task: tasks)
+            promoteCommittedWrappers(task);
+    }
+}
+
+// a SCC only reads results of its callee SCCs, which are all committed before it starts,
+// and promotions only add alloc calls to callers. results shared between SCCs that do not call each other
+// (IntraAWDPass keys) are resolved through canCommit and needsRerun, which see commits by SCC index.
+// so the wrappers do not depend on finishing order, only the order of streamed records does.
+void HAWDPass::detectWrappersAsync(unsigned maxInflight) {
+    buildArgRetSummaries();
+    pendingSeeds.clear();
+    unsigned numSCCs = Ctx->SCC.size();
+    if (!numSCCs)
+        return;
+
+    vector<SCCTask> tasks(numSCCs);
+    vector<unsigned> remainingCallees(numSCCs);
+    deque<unsigned> readySCCs;
+    deque<unsigned> finishedSCCs;
+    for (unsigned i = 0; i < numSCCs; ++i) {
+        tasks[i].sccIdx = i;
+        remainingCallees[i] = Ctx->SCCDAG.sccCallees[i].size();
+        if (!remainingCallees[i])
+            readySCCs.push_back(i);
+    }
+
+    mutex queueMutex;
+    condition_variable readyCV, finishedCV;
+    bool shutdown = false;
+    auto worker = [&]() {
+        while (true) {
+            unsigned sccIdx;
+            {
+                unique_lock<mutex> lock(queueMutex);
+                readyCV.wait(lock, [&]() { return shutdown || !readySCCs.empty(); });
+                if (readySCCs.empty())
+                    return;
+                sccIdx = readySCCs.front();
+                readySCCs.pop_front();
+            }
+            runSCCTask(tasks[sccIdx]);
+            {
+                lock_guard<mutex> lock(queueMutex);
+                finishedSCCs.push_back(sccIdx);
+            }
+            finishedCV.notify_one();
+        }
+    };
+
+    vector<thread> workers;
+    for (unsigned i = 0; i < max(1U, min(maxInflight, numSCCs)); ++i)
+        workers.emplace_back(worker);
+
+    // commits, promotions and rerun decisions are done by this thread only
+    vector<bool> committedSCCs(numSCCs, false);
+    // finished tasks waiting for canCommit, in SCC order
+    set<unsigned> waitingSCCs;
+    unsigned committed = 0;
+    while (committed < numSCCs) {
+        {
+            unique_lock<mutex> lock(queueMutex);
+            finishedCV.wait(lock, [&]() { return !finishedSCCs.empty(); });
+            waitingSCCs.insert(finishedSCCs.begin(), finishedSCCs.end());
+            finishedSCCs.clear();
+        }
+
+        // a commit may unblock waiting tasks of higher SCC index
+        bool progress = true;
+        while (progress) {
+            progress = false;
+            for (auto it = waitingSCCs.begin(); it != waitingSCCs.end();) {
+                unsigned sccIdx = *it;
+                SCCTask& task = tasks[sccIdx];
+                if (!canCommit(task, committedSCCs)) {
+                    ++it;
+                    continue;
+                }
+                it = waitingSCCs.erase(it);
+                // analyze again on a worker, it may need new LLM queries
+                if (needsRerun(task)) {
+                    task.reset();
+                    {
+                        lock_guard<mutex> lock(queueMutex);
+                        readySCCs.push_back(sccIdx);
+                    }
+                    readyCV.notify_one();
+                    continue;
+                }
 
-            set<CallBase*> potentialAllocs;
-            potentialAllocs.insert(visitedAllocCalls.begin(), visitedAllocCalls.end());
-            processPotentialAllocs(F, potentialAllocs);
+                commitTask(task);
+                promoteCommittedWrappers(task);
+                task = SCCTask();
+                committedSCCs[sccIdx] = true;
+                ++committed;
+                progress = true;
+
+                unsigned newlyReady = 0;
+                {
+                    lock_guard<mutex> lock(queueMutex);
+                    for (unsigned caller: Ctx->SCCDAG.sccCallers[sccIdx]) {
+                        if (--remainingCallees[caller])
+                            continue;
+                        readySCCs.push_back(caller);
+                        ++newlyReady;
+                    }
+                }
+                if (newlyReady == 1)
+                    readyCV.notify_one();
+                else if (newlyReady > 1)
+                    readyCV.notify_all();
+            }
+        }
+    }
 
-            bool simpleRet = true;
-            checkSimpleAlloc(F, simpleRet, potentialAllocs);
-            if (!simpleRet)
+    {
+        lock_guard<mutex> lock(queueMutex);
+        shutdown = true;
+    }
+    readyCV.notify_all();
+    for (thread& t: workers)
+        t.join();
+}
+
+void HAWDPass::promoteCommittedWrappers(SCCTask& task) {
+    unique_lock<shared_mutex> lock(commitMutex);
+    for (Function* F: task.wrappers) {
+        for (CallBase* callerCI: Ctx->CG.callerCallsites(F)) {
+            Function* callerFunc = callerCI->getFunction();
+            if (task.members.count(callerFunc))
                 continue;
+            bool isSimpleWrapper = true;
+            for (Function* _Callee: Ctx->CG.callees(callerCI)) {
+                if (!AllocWrappers.count(_Callee)) {
+                    isSimpleWrapper = false;
+                    break;
+                }
+            }
+            if (!isSimpleWrapper)
+                continue;
+            function2AllocCalls[callerFunc].insert(callerCI);
+            pendingSeeds.insert(callerFunc);
+        }
+    }
+}
 
-            // F is simple function wrapper
-            // found new simple allocation wrapper, push upper caller to worklist
-            promoteToCaller(F, visitedAllocCalls, worklist, inWorklist);
+void HAWDPass::runSCCTask(SCCTask& task) {
+    const vector<Function*>& sc = Ctx->SCC[task.sccIdx];
+    task.members.insert(sc.begin(), sc.end());
+    {
+        shared_lock<shared_mutex> lock(commitMutex);
+        for (Function* F: sc) {
+            if (!isSeed(F) && !pendingSeeds.count(F))
+                continue;
+            task.push(F, getAnalysisCost(F));
         }
     }
-    return false;
+
+    while (!task.worklist.empty()) {
+        Function* F = task.pop();
+
+        set<CallBase*> visitedAllocCalls;
+        if (!analyzeFunction(F, task, visitedAllocCalls))
+            continue;
+
+        // F is simple function wrapper
+        // found new simple allocation wrapper, push upper caller to worklist
+        promoteToCaller(F, visitedAllocCalls, task);
+    }
+}
+
+void HAWDPass::commitTask(SCCTask& task) {
+    unique_lock<shared_mutex> lock(commitMutex);
+    for (auto& item: task.allocCalls)
+        function2AllocCalls[item.first].insert(item.second.begin(), item.second.end());
+    for (auto& item: task.callInWrappers)
+        callInWrappers[item.first].insert(item.second.begin(), item.second.end());
+    AllocWrappers.insert(task.wrappers.begin(), task.wrappers.end());
+    // the level scheduler commits in SCC order, so there the stream order does not depend on the number of threads
+    for (Function* F: task.wrappers)
+        emitWrapper(F);
+}
+
+// F is only re-evaluated when a callee in its SCC became a wrapper and added new alloc calls,
+// the analysis is deterministic given the alloc calls, so otherwise the cached verdict is reused
+bool HAWDPass::analyzeFunction(Function* F, SCCTask& task, set<CallBase*>& visitedAllocCalls) {
+    FunctionVerdict& verdict = task.verdicts[F];
+    bool changed = checkWhetherAlloc(F, verdict, task);
+    visitedAllocCalls = verdict.returnedAllocCalls;
+    if (verdict.analyzed && !changed)
+        return verdict.isWrapper;
+    verdict.analyzed = true;
+    verdict.isWrapper = false;
+    if (verdict.returnedAllocCalls.empty() || verdict.leaked)
+        return false;
+
+    set<CallBase*> potentialAllocs;
+    potentialAllocs.insert(visitedAllocCalls.begin(), visitedAllocCalls.end());
+    processPotentialAllocs(F, potentialAllocs);
+
+    // determine whether F could be a simple alloc function
+    // more potential allocs never make a simple return non-simple, so a simple verdict is kept
+    if (!verdict.simpleRet) {
+        bool simpleRet = true;
+        verdict.operateGlob = checkSimpleAlloc(F, simpleRet, potentialAllocs);
+        verdict.simpleRet = simpleRet;
+        if (!simpleRet)
+            return false;
+    }
+
+    verdict.isWrapper = confirmWrapper(F, task, visitedAllocCalls, potentialAllocs, verdict.operateGlob);
+    return verdict.isWrapper;
 }
 
 // make sure all the return value come from current function
@@ -126,15 +316,18 @@ bool HAWDPass::analyzeReturn(ReturnInst* RI, set<CallBase*>& visitAllocCalls) {
             if (visitAllocCalls.count(CI))
                 continue;
             else if (CF) {
-                if (copyAPI.count(CF->getName().str())){
+                if (Ctx->APIs.isCopy(CF)){
                     worklist.push(CI->getArgOperand(0));
                     continue;
                 }
 
-                else if (func2args.count(CF)) {
-                    for (unsigned argNo: func2args[CF])
-                        worklist.push(CI->getArgOperand(argNo));
-                    continue;
+                else if (!CF->isDeclaration() && !CF->getReturnType()->isVoidTy()) {
+                    set<unsigned> argNos = getFuncArgRets(CF);
+                    if (!argNos.empty()) {
+                        for (unsigned argNo: argNos)
+                            worklist.push(CI->getArgOperand(argNo));
+                        continue;
+                    }
                 }
             }
             return false;
@@ -176,47 +369,45 @@ void HAWDPass::identifySideEffectFunctions() {
                 continue;
             bool hasSideEffect = false;
 
-            for (inst_iterator i = inst_begin(F), e = inst_end(F); i != e; ++i) {
-                if (StoreInst* SI = dyn_cast<StoreInst>(&*i)) {
-                    // store non-null pointer data should be conservatively deemed as side-effect
-                    if (analyzeStore(SI)) {
+            for (StoreInst* SI: Ctx->Facts.stores(F)) {
+                // store non-null pointer data should be conservatively deemed as side-effect
+                if (analyzeStore(SI)) {
+                    hasSideEffect = true;
+                    break;
+                }
+            }
+
+            for (CallBase* CI: Ctx->Facts.callsites(F)) {
+                if (hasSideEffect)
+                    break;
+                Function* Callee = CommonUtil::getBaseFunction(CI->getCalledOperand());
+                // recursive call, skip
+                if (Callee == F)
+                    continue;
+                // call sensitive API
+                if (Callee && Callee->isDeclaration()) {
+                    if (Ctx->APIs.isSensitive(Callee) || Ctx->APIs.isDealloc(Callee)) {
                         hasSideEffect = true;
                         break;
                     }
-                }
 
-                else if (CallBase* CI = dyn_cast<CallBase>(&*i)) {
-                    Function* Callee = CommonUtil::getBaseFunction(CI->getCalledOperand());
-                    // recursive call, skip
-                    if (Callee == F)
-                        continue;
-                    // call sensitive API
-                    if (Callee && Callee->isDeclaration()) {
-                        if (sensiAPI.count(Callee->getName().str()) || deallocAPI.count(Callee->getName().str())) {
+                    // if copy cal like: memcpy(dst, src). check whether dst is complex pointer
+                    else if (Ctx->APIs.isCopy(Callee)) {
+                        // dst could store other pointer
+                        if (analyzeCopyArg(CI->getArgOperand(0)) || analyzeCopyArg(CI->getArgOperand(1))) {
                             hasSideEffect = true;
                             break;
                         }
-
-                        // if copy cal like: memcpy(dst, src). check whether dst is complex pointer
-                        else if (copyAPI.count(Callee->getName().str())) {
-                            // dst could store other pointer
-                            if (analyzeCopyArg(CI->getArgOperand(0)) || analyzeCopyArg(CI->getArgOperand(1))) {
-                                hasSideEffect = true;
-                                break;
-                            }
-                        }
                     }
+                }
 
-                    // multiple potential callees， if one is side-effect function.
-                    // then this function is side-effect.
-                    for (Function* CF: Ctx->Callees[CI]) {
-                        if (sideEffectFuncs.count(CF)) {
-                            hasSideEffect = true;
-                            break;
-                        }
-                    }
-                    if (hasSideEffect)
+                // multiple potential callees， if one is side-effect function.
+                // then this function is side-effect.
+                for (Function* CF: Ctx->CG.callees(CI)) {
+                    if (sideEffectFuncs.count(CF)) {
+                        hasSideEffect = true;
                         break;
+                    }
                 }
             }
 
@@ -233,7 +424,7 @@ void HAWDPass::identifySideEffectFunctions() {
                         continue;
 
                     sideEffectFuncs.insert(curF);
-                    for (Function* calledF: Ctx->CalledMaps[curF])
+                    for (Function* calledF: Ctx->CG.callers(curF))
                         worklist.push(calledF);
                 }
             }
@@ -283,81 +474,89 @@ bool HAWDPass::analyzeStore(StoreInst* SI) {
 }
 
 
-void HAWDPass::promoteToCaller(Function* F, set<CallBase*>& visitedAllocCalls,
-                                queue<Function*>& worklist, set<Function*>& inWorklist) {
-    for (CallBase* CI: visitedAllocCalls)
-        callInWrappers[F].insert(CI);
-    if (!AllocWrappers.count(F)) {
-        AllocWrappers.insert(F);
-        for (CallBase* callerCI: Ctx->Callers[F]) {
-            bool isSimpleWrapper = true;
-            for (Function* _Callee: Ctx->Callees[callerCI]) {
-                if (!AllocWrappers.count(_Callee)) {
-                    isSimpleWrapper = false;
-                    break;
-                }
-            }
-            if (!isSimpleWrapper)
-                continue;
-            Function* callerFunc = callerCI->getFunction();
-            function2AllocCalls[callerFunc].insert(callerCI);
-            //
-            if (!inWorklist.count(callerFunc)) {
-                worklist.push(callerFunc);
-                inWorklist.insert(callerFunc);
+void HAWDPass::promoteToCaller(Function* F, set<CallBase*>& visitedAllocCalls, SCCTask& task) {
+    task.callInWrappers[F].insert(visitedAllocCalls.begin(), visitedAllocCalls.end());
+    if (isAllocWrapper(F, task))
+        return;
+    task.wrappers.push_back(F);
+    task.wrapperSet.insert(F);
+    // callers outside current SCC are promoted when the level is committed
+    for (CallBase* callerCI: Ctx->CG.callerCallsites(F)) {
+        Function* callerFunc = callerCI->getFunction();
+        if (!task.members.count(callerFunc))
+            continue;
+        bool isSimpleWrapper = true;
+        for (Function* _Callee: Ctx->CG.callees(callerCI)) {
+            if (!isAllocWrapper(_Callee, task)) {
+                isSimpleWrapper = false;
+                break;
             }
         }
+        if (!isSimpleWrapper)
+            continue;
+        task.allocCalls[callerFunc].insert(callerCI);
+        task.push(callerFunc, getAnalysisCost(callerFunc));
     }
 }
 
 
-void HAWDPass::checkWhetherAlloc(Function* F, bool& isAlloc, bool& everyAllocReturned,
-                                 set<CallBase*>& visitedAllocCalls) {
-    if (function2AllocCalls.count(F)) {
-        // iterate every simple alloc call in F
-        for (CallBase* curCI: function2AllocCalls[F]) {
-            set<Value*> visitedValues;
-            // if this simple alloc call could flow to return
-            if (traceValueFlow(curCI, visitedValues)) {
-                isAlloc = true;
-                visitedAllocCalls.insert(curCI);
-            }
-                // this alloc call is not returned, memory leak could exist
-            else
-                everyAllocReturned = false;
-        }
+unsigned HAWDPass::getAnalysisCost(Function* F) {
+    return Ctx->Facts.callsites(F).size() + Ctx->Facts.stores(F).size() + Ctx->Facts.returns(F).size();
+}
+
+bool HAWDPass::checkWhetherAlloc(Function* F, FunctionVerdict& verdict, SCCTask& task) {
+    // alloc calls committed by lower levels and alloc calls found in current SCC
+    set<CallBase*> allocCalls;
+    {
+        shared_lock<shared_mutex> lock(commitMutex);
+        auto it = function2AllocCalls.find(F);
+        if (it != function2AllocCalls.end())
+            allocCalls.insert(it->second.begin(), it->second.end());
+    }
+    auto localIt = task.allocCalls.find(F);
+    if (localIt != task.allocCalls.end())
+        allocCalls.insert(localIt->second.begin(), localIt->second.end());
+
+    // iterate every simple alloc call in F not traced yet
+    bool changed = false;
+    for (CallBase* curCI: allocCalls) {
+        if (!verdict.tracedAllocCalls.insert(curCI).second)
+            continue;
+        changed = true;
+        set<Value*> visitedValues;
+        // if this simple alloc call could flow to return
+        if (traceValueFlow(curCI, visitedValues))
+            verdict.returnedAllocCalls.insert(curCI);
+        // this alloc call is not returned, memory leak could exist
+        else
+            verdict.leaked = true;
     }
+    return changed;
 }
 
 
 void HAWDPass::processPotentialAllocs(Function* F, set<CallBase*>& potentialAllocs) {
-    for (inst_iterator i = inst_begin(F), e = inst_end(F); i != e; ++i) {
-        Instruction* I = &*i;
-        if (CallBase* CI = dyn_cast<CallBase>(I)) {
-            if (CI->getCalledFunction() && CI->getCalledFunction()->isIntrinsic())
-                continue;
-            bool selfCall = true;
-            for (Function* _Callee: Ctx->Callees[CI]) {
-                if (_Callee != F) {
-                    selfCall = false;
-                    break;
-                }
+    for (CallBase* CI: Ctx->Facts.callsites(F)) {
+        if (CI->getCalledFunction() && CI->getCalledFunction()->isIntrinsic())
+            continue;
+        bool selfCall = true;
+        for (Function* _Callee: Ctx->CG.callees(CI)) {
+            if (_Callee != F) {
+                selfCall = false;
+                break;
             }
-            if (selfCall)
-                potentialAllocs.insert(CI);
         }
+        if (selfCall)
+            potentialAllocs.insert(CI);
     }
 }
 
 
 bool HAWDPass::checkSimpleAlloc(Function* F, bool &simpleRet, set<CallBase*>& potentialAllocs) {
-    for (inst_iterator i = inst_begin(F), e = inst_end(F); i != e; ++i) {
-        Instruction* I = &*i;
-        if (ReturnInst* RI = dyn_cast<ReturnInst>(I)) {
-            if (!analyzeReturn(RI, potentialAllocs)) {
-                simpleRet = false;
-                break;
-            }
+    for (ReturnInst* RI: Ctx->Facts.returns(F)) {
+        if (!analyzeReturn(RI, potentialAllocs)) {
+            simpleRet = false;
+            break;
         }
     }
     return false;
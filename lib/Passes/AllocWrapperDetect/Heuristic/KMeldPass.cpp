@@ -6,29 +6,57 @@
 #include <queue>
 
 #include "Passes/AllocWrapperDetect/Heuristic/KMeldPass.h"
+#include "Utils/Tool/Parallel.h"
 
 using namespace std;
 
 bool KMeldPass::doModulePass(Module* M) {
-    for (Function& F: *M) {
-        if (!backwardAnalysis(&F))
+    if (forwardVerdicts.size() != Ctx->CG.getNumCallsites())
+        forwardVerdicts = vector<atomic<uint8_t>>(Ctx->CG.getNumCallsites());
+
+    vector<Function*> funcs;
+    for (Function& F: *M)
+        funcs.push_back(&F);
+
+    // 按函数并行分析，结果按函数顺序合并
+    vector<char> isWrapper(funcs.size(), 0);
+    parallelFor(funcs.size(), [&](size_t i) {
+        // potentially a allocation function, and no callsite lacks null check or initialization
+        isWrapper[i] = backwardAnalysis(funcs[i]) && checkCallsites(funcs[i]);
+    });
+
+    for (size_t i = 0; i < funcs.size(); ++i) {
+        if (!isWrapper[i])
             continue;
-        // potentially a allocation function
-        bool flag = true;
-        for (CallBase* CB: Ctx->Callers[&F]) {
-            // no null check or initialization
-            if (!forwardAnalysis(CB)) {
-                flag = false;
-                break;
-            }
-        }
-
-        if (flag)
-            AllocWrappers.insert(&F);
+        AllocWrappers.insert(funcs[i]);
+        // KMeld does not track wrapped calls
+        Ctx->WrapperStream.emit(ID, funcs[i], set<CallBase*>(), Ctx->CG);
     }
     return false;
 }
 
+bool KMeldPass::getForwardVerdict(unsigned callsiteID) {
+    uint8_t verdict = forwardVerdicts[callsiteID].load(memory_order_relaxed);
+    if (verdict != VerdictUnknown)
+        return verdict == VerdictPass;
+    // 结论只依赖callsite本身，并发重复计算得到的结果相同
+    bool pass = forwardAnalysis(Ctx->CG.getCallsite(callsiteID));
+    forwardVerdicts[callsiteID].store(pass ? VerdictPass : VerdictFail, memory_order_relaxed);
+    return pass;
+}
+
+bool KMeldPass::checkCallsites(Function* F) {
+    ArrayRef<unsigned> callsiteIDs = Ctx->CG.callerCallsiteIDs(Ctx->CG.getFunctionID(F));
+    // 先查看已缓存的失败结论，避免为前面的callsite做无用分析
+    for (unsigned id: callsiteIDs)
+        if (forwardVerdicts[id].load(memory_order_relaxed) == VerdictFail)
+            return false;
+    for (unsigned id: callsiteIDs)
+        if (!getForwardVerdict(id))
+            return false;
+    return true;
+}
+
 // check F 1.return a pointer 2.return value not refer GetElementPtr and Argument
 bool KMeldPass::backwardAnalysis(Function* F) {
     // return type not pointer
@@ -210,12 +238,12 @@ BasicBlock* KMeldPass::getNonNullSuccessor(BranchInst *br, CallBase *targetCB) {
     // icmp eq/ne targetCB, null
     if (op0 == targetCB && isNullValue(op1)) {
         isNotNullCheck = (icmp->getPredicate() == CmpInst::ICMP_NE);
-        nonNullSucc = isNotNullCheck ? br->getSuccessor(0) : br->getSuccessor(1);
+        nonNullSucc = Ctx->LoopCache.getSuccessor(br, isNotNullCheck ? 0 : 1);
     }
     // icmp eq/ne null, targetCB
     else if (op1 == targetCB && isNullValue(op0)) {
         isNotNullCheck = (icmp->getPredicate() == CmpInst::ICMP_NE);
-        nonNullSucc = isNotNullCheck ? br->getSuccessor(0) : br->getSuccessor(1);
+        nonNullSucc = Ctx->LoopCache.getSuccessor(br, isNotNullCheck ? 0 : 1);
     }
 
     return nonNullSucc;
@@ -4,169 +4,308 @@
 #include <llvm/IR/InstIterator.h>
 #include <llvm/IR/Instructions.h>
 #include <llvm/IR/DebugInfoMetadata.h>
+#include <chrono>
 #include <queue>
-#include <filesystem>
 
 #include "Passes/AllocWrapperDetect/LLM/IntraAWDPass.h"
-#include "Utils/Basic/Tarjan.h"
 #include "Utils/Tool/Common.h"
 
+const FunctionInfo* IntraAWDPass::getSourceInfo(Function* F, string& key) {
+    DISubprogram* SP = F->getSubprogram();
+    if (!SP)
+        return nullptr;
+    string fileName = getNormalizedPath(SP);
+    string funcName = removeFuncNumberSuffix(F->getName().str());
+    key = extractKey(fileName, SP->getLine(), funcName);
+    auto infoIt = sourceInfos.find(key);
+    if (infoIt == sourceInfos.end()) {
+        key = extractKey(fileName, SP->getLine() - 1, funcName);
+        infoIt = sourceInfos.find(key);
+        if (infoIt == sourceInfos.end())
+            return nullptr;
+    }
+    return &infoIt->second;
+}
+
 bool IntraAWDPass::doModulePass(Module* M) {
-    // analyze strong connected component
-    Tarjan tarjan(Ctx->CallMaps);
-    tarjan.getSCC(Ctx->SCC);
     // first identify side-effect functions
     identifySideEffectFunctions();
     // identify simple allocation wrappers
-    set<string> visitedKeys;
-    for (vector<Function*> sc: Ctx->SCC) {
-        queue<Function*> worklist;
-        set<Function*> inWorklist;
-
-        for (Function* F : sc) {
-            worklist.push(F);
-            inWorklist.insert(F);
+    visitedKeys.clear();
+    // SCCs that may claim each key, only keys shared by several SCCs are kept
+    keySCCs.clear();
+    for (unsigned i = 0; i < Ctx->SCC.size(); ++i) {
+        for (Function* F: Ctx->SCC[i]) {
+            string key;
+            if (getSourceInfo(F, key) && (keySCCs[key].empty() || keySCCs[key].back() != i))
+                keySCCs[key].push_back(i);
         }
+    }
+    for (auto it = keySCCs.begin(); it != keySCCs.end();) {
+        if (it->second.size() < 2)
+            it = keySCCs.erase(it);
+        else
+            ++it;
+    }
+    promptVerdicts.clear();
+    sharedPromptNum = 0;
+    // SCCs are committed as their LLM answers arrive
+    detectWrappersAsync(maxInflightSCCs);
+    if (dedupPrompts)
+        OP << "LLM prompts: " << promptVerdicts.size() << " queried, " << sharedPromptNum
+           << " shared by functions with identical code\n";
+    return false;
+}
 
-        while (!worklist.empty()) {
-            Function* F = worklist.front();
-            worklist.pop();
-            inWorklist.erase(F);
-
-            bool isAlloc = false;
-            bool everyAllocReturned = true;
-            set<CallBase*> visitedAllocCalls;
-            checkWhetherAlloc(F, isAlloc, everyAllocReturned, visitedAllocCalls);
-            if (!isAlloc || !everyAllocReturned)
-                continue;
-
-            set<CallBase*> potentialAllocs;
-            potentialAllocs.insert(visitedAllocCalls.begin(), visitedAllocCalls.end());
-            processPotentialAllocs(F, potentialAllocs);
-
-            bool simpleRet = true;
-            bool operateGlob = checkSimpleAlloc(F, simpleRet, potentialAllocs);
-            if (!simpleRet)
-                continue;
-
-            // has side-effect
-            if (func2SideEffectOps.count(F)) {
-                // generate query for LLM
-                string fileName = getNormalizedPath(F->getSubprogram());
-                string funcName = removeFuncNumberSuffix(F->getName().str());
-                string key = extractKey(fileName, F->getSubprogram()->getLine(), funcName);
-                FunctionInfo info;
-                if (sourceInfos.count(key))
-                    info = sourceInfos[key];
-                else {
-                    key = extractKey(fileName, F->getSubprogram()->getLine() - 1, funcName);
-                    if (!sourceInfos.count(key))
-                        continue;
-                    info = sourceInfos[key];
-                }
+// 函数名替换为占位符(只替换完整标识符)，连续空白合并为一个空格
+static string normalizePrompt(const string& prompt, const string& funcName) {
+    auto isIdentChar = [](char c) { return isalnum((unsigned char) c) || c == '_'; };
+    string normalized;
+    normalized.reserve(prompt.size());
+    size_t i = 0;
+    while (i < prompt.size()) {
+        if (!funcName.empty() && prompt.compare(i, funcName.size(), funcName) == 0 &&
+            (i == 0 || !isIdentChar(prompt[i - 1])) &&
+            (i + funcName.size() == prompt.size() || !isIdentChar(prompt[i + funcName.size()]))) {
+            normalized.append("<func>");
+            i += funcName.size();
+            continue;
+        }
+        if (isspace((unsigned char) prompt[i])) {
+            while (i < prompt.size() && isspace((unsigned char) prompt[i]))
+                ++i;
+            normalized.push_back(' ');
+            continue;
+        }
+        normalized.push_back(prompt[i++]);
+    }
+    return strip(normalized);
+}
 
-                if (visitedKeys.count(key))
-                    continue;
-                visitedKeys.insert(key);
-
-                // count side-effect instructions
-                bool sideEffectIgnorable = true;
-                bool llmEnable = true;
-                set<string> sideEffectCalled;
-                set<string> directAllocCalled;
-                set<string> indirectAllocCalled;
-                // traverse every side-effect instruction
-                for (pair<Instruction*, SideEffectType> sideEffect: func2SideEffectOps[F]) {
-                    if (sideEffect.second == SideEffectType::Store) {
-                        sideEffectIgnorable = false;
-                        llmEnable = false;
-                        break;
-                    }
-                    CallBase* CI = dyn_cast<CallBase>(sideEffect.first);
-                    // unknown side-effect indirect-call
-                    if (CI->isIndirectCall() && !potentialAllocs.count(CI))
-                        llmEnable = false;
-
-                    if (!potentialAllocs.count(CI)) {
-                        bool allArgSimpleType = !isComplexType(CI->getType());
-                        for (unsigned i = 0; i < CI->getNumOperands() - 1; ++i) {
-                            if (isComplexType(CI->getArgOperand(i)->getType())) {
-                                allArgSimpleType = false;
-                                break;
-                            }
-                        }
-                        if (!allArgSimpleType || operateGlob) {
-                            sideEffectIgnorable = false;
-                            Function* sideEffectCallee = CommonUtil::getBaseFunction(CI->getCalledOperand());
-                            if (sideEffectCallee)
-                                sideEffectCalled.insert(removeFuncNumberSuffix(sideEffectCallee->getName().str()));
-                        }
-                    }
-                }
+// 每次分类一条日志记录，sharedWith非空表示复用了该key的分类结果
+static json getLogRecord(const string& key, const string& userPrompt, const ClassifyRecord& record,
+                         const string& sharedWith = "") {
+    int64_t ts = chrono::duration_cast<chrono::milliseconds>(
+            chrono::system_clock::now().time_since_epoch()).count();
+    json logRecord = {{"key", key}, {"ts", ts}, {"answer", record.answer ? "yes" : "no"}};
+    if (!sharedWith.empty()) {
+        logRecord["shared_with"] = sharedWith;
+        return logRecord;
+    }
+    logRecord["prompt"] = userPrompt;
+    logRecord["responses"] = record.responses;
+    logRecord["votes"] = {{"yes", record.yesVotes}, {"no", record.noVotes}, {"skipped", record.skippedVotes}};
+    logRecord["latency_ms"] = (int64_t) record.latencyMs;
+    logRecord["prompt_tokens"] = record.inputTokens;
+    logRecord["completion_tokens"] = record.outputTokens;
+    return logRecord;
+}
+
+pair<bool, vector<string>> IntraAWDPass::classifyPrompt(const string& key, const string& funcName, string& userPrompt) {
+    if (!dedupPrompts) {
+        vector<string> curLogs;
+        curLogs.emplace_back("key: " + key);
+        ClassifyRecord record;
+        bool isSimple = llmAnalyzer->classify(IntraSysPrompt, userPrompt, SummarizingTemplate, curLogs, &record);
+        if (logSink)
+            logSink->emit(getLogRecord(key, userPrompt, record));
+        return make_pair(isSimple, curLogs);
+    }
+
+    string normalized = normalizePrompt(userPrompt, funcName);
+    promise<pair<bool, vector<string>>> result;
+    string ownerKey;
+    shared_future<pair<bool, vector<string>>> verdict;
+    bool owner = false;
+    {
+        lock_guard<mutex> lock(promptVerdictsMutex);
+        auto it = promptVerdicts.find(normalized);
+        if (it == promptVerdicts.end()) {
+            owner = true;
+            ownerKey = key;
+            verdict = result.get_future().share();
+            promptVerdicts.emplace(normalized, make_pair(key, verdict));
+        }
+        else {
+            ownerKey = it->second.first;
+            verdict = it->second.second;
+        }
+    }
+
+    if (owner) {
+        vector<string> curLogs;
+        curLogs.emplace_back("key: " + key);
+        ClassifyRecord record;
+        bool isSimple = llmAnalyzer->classify(IntraSysPrompt, userPrompt, SummarizingTemplate, curLogs, &record);
+        result.set_value(make_pair(isSimple, curLogs));
+        if (logSink)
+            logSink->emit(getLogRecord(key, userPrompt, record));
+        return make_pair(isSimple, curLogs);
+    }
+
+    // the same prompt is queried by another function, possibly still in flight
+    ++sharedPromptNum;
+    bool isSimple = verdict.get().first;
+    vector<string> curLogs;
+    curLogs.emplace_back("key: " + key);
+    curLogs.emplace_back("prompt identical to key: " + ownerKey);
+    curLogs.emplace_back(isSimple ? "final answer: yes" : "final answer: no");
+    if (logSink) {
+        ClassifyRecord record;
+        record.answer = isSimple;
+        logSink->emit(getLogRecord(key, userPrompt, record, ownerKey));
+    }
+    return make_pair(isSimple, curLogs);
+}
+
+bool IntraAWDPass::confirmWrapper(Function* F, SCCTask& task, set<CallBase*>& visitedAllocCalls,
+                                  set<CallBase*>& potentialAllocs, bool operateGlob) {
+    // has no side-effect
+    const SideEffectOps* sideEffectOps = getSideEffectOps(F);
+    if (!sideEffectOps)
+        return true;
+
+    // generate query for LLM
+    string funcName = removeFuncNumberSuffix(F->getName().str());
+    string key;
+    const FunctionInfo* infoPtr = getSourceInfo(F, key);
+    if (!infoPtr)
+        return false;
+    const FunctionInfo& info = *infoPtr;
 
-                // if this is a indirect-call, first conservatively treat it.
-                // this function can not be simple treat as simple wrapper
-                if (!sideEffectIgnorable) {
-                    bool isSimple = false;
-                    if (llmEnable) {
-                        string code;
-                        bool preprocessed = false;
-                        if (!info.second.empty()) {
-                            preprocessed = true;
-                            code = info.second;
-                        }
-                        else
-                            code = info.first;
-                        string sideEffectCalledStr;
-                        for (const string& _funcName: sideEffectCalled)
-                            sideEffectCalledStr += (_funcName + ",");
-                        if (!sideEffectCalledStr.empty())
-                            sideEffectCalledStr = sideEffectCalledStr.substr(0, sideEffectCalledStr.size() - 1);
-
-                        for (CallBase* allocCI: visitedAllocCalls) {
-                            if (allocCI->isIndirectCall()) {
-                                for (Function* allocCallee: Ctx->Callees[allocCI])
-                                    indirectAllocCalled.insert(removeFuncNumberSuffix(allocCallee->getName().str()));
-                            }
-                            else {
-                                Function* allocFunc = CommonUtil::getBaseFunction(allocCI->getCalledOperand());
-                                directAllocCalled.insert(removeFuncNumberSuffix(allocFunc->getName().str()));
-                            }
-                        }
-
-                        string preprocessed_text =  preprocessed ? "preprocessed " : "";
-                        string userPrompt = IntraUserTemplate;
-                        userPrompt = replaceAll(userPrompt, "{function_name}", funcName);
-                        userPrompt = replaceAll(userPrompt, "{preprocessed}", preprocessed_text);
-                        userPrompt = replaceAll(userPrompt, "{side_effects}", sideEffectCalledStr);
-                        userPrompt = replaceAll(userPrompt, "{function_code}", code);
-                        vector<string> curLogs;
-                        curLogs.emplace_back("key: " + key);
-                        isSimple = llmAnalyzer->classify(IntraSysPrompt, userPrompt, SummarizingTemplate, curLogs);
-
-                        if (!logDir.empty()) {
-                            string file = "cout";
-                            if (logDir != "cout") {
-                                int existingFiles = 0;
-                                for (const auto& entry: filesystem::directory_iterator(logDir)) {
-                                    if (entry.is_regular_file() && entry.path().extension() == ".txt")
-                                        existingFiles++;
-                                }
-                                file = logDir + "/" + to_string(existingFiles + 1) + ".txt";
-                            }
-                            log(file, curLogs);
-                        }
-                    }
-
-                    if (!isSimple)
-                        continue;
+    // keys claimed by other SCCs of the same level are checked when the task is committed
+    if (task.claimedKeys.count(key))
+        return false;
+    {
+        shared_lock<shared_mutex> lock(commitMutex);
+        if (visitedKeys.count(key))
+            return false;
+    }
+    task.claimedKeys.insert(key);
+
+    // count side-effect instructions
+    bool sideEffectIgnorable = true;
+    bool llmEnable = true;
+    set<string> sideEffectCalled;
+    set<string> directAllocCalled;
+    set<string> indirectAllocCalled;
+    // traverse every side-effect instruction
+    for (const pair<Instruction*, SideEffectType>& sideEffect: *sideEffectOps) {
+        if (sideEffect.second == SideEffectType::Store) {
+            sideEffectIgnorable = false;
+            llmEnable = false;
+            break;
+        }
+        CallBase* CI = dyn_cast<CallBase>(sideEffect.first);
+        // unknown side-effect indirect-call
+        if (CI->isIndirectCall() && !potentialAllocs.count(CI))
+            llmEnable = false;
+
+        if (!potentialAllocs.count(CI)) {
+            bool allArgSimpleType = !isComplexType(CI->getType());
+            for (unsigned i = 0; i < CI->getNumOperands() - 1; ++i) {
+                if (isComplexType(CI->getArgOperand(i)->getType())) {
+                    allArgSimpleType = false;
+                    break;
                 }
             }
+            if (!allArgSimpleType || operateGlob) {
+                sideEffectIgnorable = false;
+                Function* sideEffectCallee = CommonUtil::getBaseFunction(CI->getCalledOperand());
+                if (sideEffectCallee)
+                    sideEffectCalled.insert(removeFuncNumberSuffix(sideEffectCallee->getName().str()));
+            }
+        }
+    }
+
+    if (sideEffectIgnorable)
+        return true;
+    // if this is a indirect-call, first conservatively treat it.
+    // this function can not be simple treat as simple wrapper
+    if (!llmEnable)
+        return false;
+
+    auto verdictIt = task.llmVerdicts.find(key);
+    if (verdictIt == task.llmVerdicts.end()) {
+        string code;
+        bool preprocessed = false;
+        if (!info.second.empty()) {
+            preprocessed = true;
+            code = info.second;
+        }
+        else
+            code = info.first;
+        string sideEffectCalledStr;
+        for (const string& _funcName: sideEffectCalled)
+            sideEffectCalledStr += (_funcName + ",");
+        if (!sideEffectCalledStr.empty())
+            sideEffectCalledStr = sideEffectCalledStr.substr(0, sideEffectCalledStr.size() - 1);
 
-            // F is simple function wrapper
-            // found new simple allocation wrapper, push upper caller to worklist
-            promoteToCaller(F, visitedAllocCalls, worklist, inWorklist);
+        for (CallBase* allocCI: visitedAllocCalls) {
+            if (allocCI->isIndirectCall()) {
+                for (Function* allocCallee: Ctx->CG.callees(allocCI))
+                    indirectAllocCalled.insert(removeFuncNumberSuffix(allocCallee->getName().str()));
+            }
+            else {
+                Function* allocFunc = CommonUtil::getBaseFunction(allocCI->getCalledOperand());
+                directAllocCalled.insert(removeFuncNumberSuffix(allocFunc->getName().str()));
+            }
+        }
+
+        string preprocessed_text =  preprocessed ? "preprocessed " : "";
+        string userPrompt = IntraUserTemplate;
+        userPrompt = replaceAll(userPrompt, "{function_name}", funcName);
+        userPrompt = replaceAll(userPrompt, "{preprocessed}", preprocessed_text);
+        userPrompt = replaceAll(userPrompt, "{side_effects}", sideEffectCalledStr);
+        userPrompt = replaceAll(userPrompt, "{function_code}", code);
+        verdictIt = task.llmVerdicts.emplace(key, classifyPrompt(key, funcName, userPrompt)).first;
+    }
+
+    if (logDir == "cout")
+        task.logs.push_back(verdictIt->second.second);
+    return verdictIt->second.first;
+}
+
+// a key claimed by several SCCs goes to the one with the lowest index, so a task waits until
+// every lower SCC that may claim one of its keys is committed
+bool IntraAWDPass::canCommit(SCCTask& task, const vector<bool>& committedSCCs) {
+    for (const string& key: task.claimedKeys) {
+        auto it = keySCCs.find(key);
+        if (it == keySCCs.end())
+            continue;
+        for (unsigned sccIdx: it->second) {
+            if (sccIdx >= task.sccIdx)
+                break;
+            if (!committedSCCs[sccIdx])
+                return false;
         }
     }
+    return true;
+}
+
+// tasks are committed by one thread, so visitedKeys can not change during the check
+bool IntraAWDPass::needsRerun(SCCTask& task) {
+    for (const string& key: task.claimedKeys)
+        if (visitedKeys.count(key))
+            return true;
     return false;
-}
\ No newline at end of file
+}
+
+void IntraAWDPass::commitTask(SCCTask& task) {
+    // a key is also claimed by a committed SCC, rerun the task as if it was analyzed after that SCC.
+    // LLM verdicts of the first run are reused. the async scheduler reruns on a worker before calling commitTask
+    if (needsRerun(task)) {
+        task.reset();
+        runSCCTask(task);
+    }
+    {
+        unique_lock<shared_mutex> lock(commitMutex);
+        visitedKeys.insert(task.claimedKeys.begin(), task.claimedKeys.end());
+    }
+
+    // 写到目录的记录已在分类完成时交给logSink
+    for (vector<string>& curLogs: task.logs)
+        log("cout", curLogs);
+
+    HAWDPass::commitTask(task);
+}
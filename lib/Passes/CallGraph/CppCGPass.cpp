@@ -7,6 +7,7 @@
 
 #include "Passes/CallGraph/CppCGPass.h"
 #include "Utils/Tool/CppUtil.h"
+#include "Utils/Tool/Parallel.h"
 
 const string pureVirtualFunName = "__cxa_pure_virtual";
 const string ztiLabel = "_ZTI";
@@ -22,13 +23,28 @@ static const ConstantExpr* isCastConstantExpr(const Value* val) {
 bool CppCGPass::doInitialization(Module* M) {
     KELPPass::doInitialization(M);
 
+    // vtables and constructors of all modules are scanned in parallel on the first call,
+    // fragments are merged in module order so the hierarchy is the same as a serial scan
+    if (!fragmentsMerged) {
+        vector<CHAFragment> fragments(Ctx->Modules.size());
+        parallelFor(Ctx->Modules.size(), [&](size_t i) {
+            collectCHAFragment(Ctx->Modules[i].first, fragments[i]);
+        });
+        for (CHAFragment& fragment: fragments)
+            mergeCHAFragment(fragment);
+        fragmentsMerged = true;
+    }
+    return false;
+}
+
+void CppCGPass::collectCHAFragment(Module* M, CHAFragment& fragment) {
     // collect class names in vtables
     for (Module::const_global_iterator I = M->global_begin(), E = M->global_end(); I != E; ++I) {
         const GlobalVariable* GV = &*I;
         if (CppUtil::isValVtbl(GV) && GV->getNumOperands() > 0) {
             const ConstantStruct *vtblStruct = CppUtil::getVtblStruct(GV);
             string className = CppUtil::getClassNameFromVtblObj(GV->getName().str());
-            ClassNames.insert(className);
+            fragment.ClassNames.insert(className);
 
             for (unsigned int ei = 0; ei < vtblStruct->getNumOperands(); ++ei) {
                 const ConstantArray* vtbl = dyn_cast<ConstantArray>(vtblStruct->getOperand(ei));
@@ -38,7 +54,7 @@ bool CppCGPass::doInitialization(Module* M) {
                         const Value* bitcastValue = ce->getOperand(0);
                         if (const  Function* func = dyn_cast<Function>(bitcastValue)) {
                             DemangledName dname = CppUtil::demangle(func->getName().str());
-                            ClassNames.insert(dname.className);
+                            fragment.ClassNames.insert(dname.className);
                         }
                     }
                 }
@@ -53,28 +69,47 @@ bool CppCGPass::doInitialization(Module* M) {
         if (CppUtil::isConstructor(F) || CppUtil::isDestructor(F)) {
             // collect class name
             DemangledName dname = CppUtil::demangle(F->getName().str());
-            DBG << "\t build CHANode for class " + dname.className + "...\n";
-            ClassNames.insert(dname.className);
+            if (debug_mode)
+                fragment.DebugLogs.push_back("\t build CHANode for class " + dname.className + "...\n");
+            fragment.ClassNames.insert(dname.className);
 
             // collect super class information
             for (Function::const_iterator B = F->begin(), E = F->end(); B != E; ++B) {
                 for (BasicBlock::const_iterator I = B->begin(); I != B->end(); ++I) {
                     if (const CallBase* CB = dyn_cast<CallBase>(I))
-                        connectInheritEdgeViaCall(F, CB);
+                        connectInheritEdgeViaCall(F, CB, fragment);
                     else if (const StoreInst* SI = dyn_cast<StoreInst>(I))
-                        connectInheritEdgeViaStore(F, SI);
+                        connectInheritEdgeViaStore(F, SI, fragment);
                 }
             }
         }
     }
 
     // analyze vtables
-    analyzeVTables(M);
-    return false;
+    analyzeVTables(M, fragment);
+}
+
+void CppCGPass::mergeCHAFragment(CHAFragment& fragment) {
+    for (const string& log: fragment.DebugLogs)
+        DBG << log;
+    ClassNames.insert(fragment.ClassNames.begin(), fragment.ClassNames.end());
+    for (auto& item: fragment.BottomUpClassHierarchyChain)
+        BottomUpClassHierarchyChain[item.first].insert(item.second.begin(), item.second.end());
+    for (auto& item: fragment.TopDownClassHierarchyChain)
+        TopDownClassHierarchyChain[item.first].insert(item.second.begin(), item.second.end());
+    for (auto& item: fragment.ClassHierarchy)
+        ClassHierarchy[item.first] |= item.second;
+    for (auto& item: fragment.virtualFuncVecs) {
+        vector<vector<const Function*>>& funcVecs = virtualFuncVecs[item.first];
+        funcVecs.insert(funcVecs.end(), make_move_iterator(item.second.begin()), make_move_iterator(item.second.end()));
+    }
+    // later modules overwrite vtables of the same class, as the serial scan did
+    for (auto& item: fragment.vtables)
+        vtables[item.first] = item.second;
 }
 
 // check whether it calls constructor of other classes
-void CppCGPass::connectInheritEdgeViaCall(const Function* F, const CallBase* CB) {
+void CppCGPass::connectInheritEdgeViaCall(const Function* F, const CallBase* CB, CHAFragment& fragment) {
     // should be a direct call
     if (!CB->getCalledFunction())
         return;
@@ -91,16 +126,14 @@ void CppCGPass::connectInheritEdgeViaCall(const Function* F, const CallBase* CB)
         // make sure the called constructor has the same this ptr with this constructor
         if (csThisPtr != nullptr && samePtr) {
             DemangledName basename = CppUtil::demangle(callee->getName().str());
-            if (!isa<CallBase>(csThisPtr) && !basename.className.empty()) {
-                BottomUpClassHierarchyChain[dname.className].insert(basename.className);
-                TopDownClassHierarchyChain[basename.className].insert(dname.className);
-            }
+            if (!isa<CallBase>(csThisPtr) && !basename.className.empty())
+                fragment.addInheritEdge(dname.className, basename.className);
         }
     }
 }
 
 // F is a constructor or destructor
-void CppCGPass::connectInheritEdgeViaStore(const Function* F, const StoreInst* SI) {
+void CppCGPass::connectInheritEdgeViaStore(const Function* F, const StoreInst* SI, CHAFragment& fragment) {
     DemangledName dname = CppUtil::demangle(F->getName().str());
     if (const ConstantExpr* ce = dyn_cast<ConstantExpr>(SI->getValueOperand())) {
         if (ce->getOpcode() == Instruction::BitCast) {
@@ -110,10 +143,8 @@ void CppCGPass::connectInheritEdgeViaStore(const Function* F, const StoreInst* S
                     const Value* gepval = bcce->getOperand(0);
                     if (CppUtil::isValVtbl(gepval)) {
                         string vtblClassName = CppUtil::getClassNameFromVtblObj(gepval->getName().str());
-                        if (!vtblClassName.empty() && dname.className.compare(vtblClassName) != 0){
-                            BottomUpClassHierarchyChain[dname.className].insert(vtblClassName);
-                            TopDownClassHierarchyChain[vtblClassName].insert(dname.className);
-                        }
+                        if (!vtblClassName.empty() && dname.className.compare(vtblClassName) != 0)
+                            fragment.addInheritEdge(dname.className, vtblClassName);
                     }
                 }
             }
@@ -152,14 +183,14 @@ void CppCGPass::connectInheritEdgeViaStore(const Function* F, const StoreInst* S
  * number of "i8 *null" is the same as the number of virtual methods in
  * "class A"
  */
-void CppCGPass::analyzeVTables(Module* M) {
+void CppCGPass::analyzeVTables(Module* M, CHAFragment& fragment) {
     for (Module::const_global_iterator I = M->global_begin(), E = M->global_end(); I != E; ++I) {
         // vtable variables
         const GlobalValue* globalvalue = dyn_cast<const GlobalValue>(&(*I));
         if (CppUtil::isValVtbl(globalvalue) && globalvalue->getNumOperands() > 0) {
             const ConstantStruct* vtblStruct = CppUtil::getVtblStruct(globalvalue);
             string vtblClassName = CppUtil::getClassNameFromVtblObj(globalvalue->getName().str());
-            vtables[vtblClassName] = globalvalue;
+            fragment.vtables[vtblClassName] = globalvalue;
             for (unsigned int ei = 0; ei < vtblStruct->getNumOperands(); ++ei) {
                 const ConstantArray* vtbl = dyn_cast<ConstantArray>(vtblStruct->getOperand(ei));
                 assert(vtbl && "Element of initializer not an array?");
@@ -203,7 +234,7 @@ void CppCGPass::analyzeVTables(Module* M) {
                             continue;
                         }
 
-                        auto foo = [this, &virtualFunctions, &pure_abstract, &vtblClassName](const Value* operand) {
+                        auto foo = [this, &fragment, &virtualFunctions, &pure_abstract, &vtblClassName](const Value* operand) {
                             if (const Function* f = dyn_cast<Function>(operand)) {
                                 addFuncToFuncVector(virtualFunctions, f);
                                 if (f->getName().str().compare(pureVirtualFunName) == 0)
@@ -211,10 +242,8 @@ void CppCGPass::analyzeVTables(Module* M) {
                                 else
                                     pure_abstract &= false;
                                 DemangledName dname = CppUtil::demangle(f->getName().str());
-                                if (!dname.className.empty() && vtblClassName.compare(dname.className) != 0) {
-                                    BottomUpClassHierarchyChain[vtblClassName].insert(dname.className);
-                                    TopDownClassHierarchyChain[dname.className].insert(vtblClassName);
-                                }
+                                if (!dname.className.empty() && vtblClassName.compare(dname.className) != 0)
+                                    fragment.addInheritEdge(vtblClassName, dname.className);
                             }
                             else {
                                 if (const GlobalAlias* alias = dyn_cast<GlobalAlias>(operand)) {
@@ -262,7 +291,7 @@ void CppCGPass::analyzeVTables(Module* M) {
                             assert(ce->getNumOperands() == 1 &&
                                    "cast operand num not 1");
                             if (opcode == Instruction::IntToPtr) {
-                                ClassHierarchy[vtblClassName] |= MULTI_INHERITANCE;
+                                fragment.ClassHierarchy[vtblClassName] |= MULTI_INHERITANCE;
                                 ++i;
                                 break;
                             }
@@ -279,11 +308,11 @@ void CppCGPass::analyzeVTables(Module* M) {
                         }
                     }
                     if (!virtualFunctions.empty())
-                        virtualFuncVecs[vtblClassName].push_back(virtualFunctions);
+                        fragment.virtualFuncVecs[vtblClassName].push_back(virtualFunctions);
 
                 }
                 if (pure_abstract == true)
-                    ClassHierarchy[vtblClassName] |= PURE_ABSTRACT;
+                    fragment.ClassHierarchy[vtblClassName] |= PURE_ABSTRACT;
             }
         }
     }
@@ -84,35 +84,32 @@ bool KELPPass::doInitialization(Module* M) {
     for (Function &F: *M) {
         if (F.isDeclaration())
             continue;
-        for (inst_iterator i = inst_begin(F), e = inst_end(F); i != e; ++i) {
-            Instruction *I = &*i;
-            if (CallBase* CI = dyn_cast<CallBase>(I)) {
-                if (!CI->isIndirectCall())
-                    continue;
-                set<Function*> callees;
-                set<Value*> defUseSites;
-                set<Function*> visitedFuncs;
-
-                // if refered to global variables
-                if (GlobalVariable* GV = dyn_cast<GlobalVariable>(CI->getCalledOperand())) {
-                    if (confinedGlobs2Funcs.count(GV)) {
-                        simpleIndCalls.insert(CI);
-                        Ctx->Callees[CI].insert(confinedGlobs2Funcs[GV].begin(), confinedGlobs2Funcs[GV].end());
-                        potentialConfFuncs.insert(callees.begin(), callees.end());
-                        continue;
-                    }
-                }
+        for (CallBase* CI: Ctx->Facts.callsites(&F)) {
+            if (!CI->isIndirectCall())
+                continue;
+            set<Function*> callees;
+            set<Value*> defUseSites;
+            set<Function*> visitedFuncs;
 
-                bool flag = resolveSFP(CI, CI->getCalledOperand(), callees, defUseSites, visitedFuncs);
-                // simple indirect call
-                if (flag) {
+            // if refered to global variables
+            if (GlobalVariable* GV = dyn_cast<GlobalVariable>(CI->getCalledOperand())) {
+                if (confinedGlobs2Funcs.count(GV)) {
                     simpleIndCalls.insert(CI);
-                    Ctx->Callees[CI].insert(callees.begin(), callees.end());
-                    // mark those function as potential confined functions
+                    Ctx->Callees[CI].insert(confinedGlobs2Funcs[GV].begin(), confinedGlobs2Funcs[GV].end());
                     potentialConfFuncs.insert(callees.begin(), callees.end());
-                    totalDefUseSites.insert(defUseSites.begin(), defUseSites.end());
+                    continue;
                 }
             }
+
+            bool flag = resolveSFP(CI, CI->getCalledOperand(), callees, defUseSites, visitedFuncs);
+            // simple indirect call
+            if (flag) {
+                simpleIndCalls.insert(CI);
+                Ctx->Callees[CI].insert(callees.begin(), callees.end());
+                // mark those function as potential confined functions
+                potentialConfFuncs.insert(callees.begin(), callees.end());
+                totalDefUseSites.insert(defUseSites.begin(), defUseSites.end());
+            }
         }
 
         // resolve confined function with pure sys API call.
@@ -0,0 +1,83 @@
+//
+// Created on 2026/10/19.
+//
+
+#include <llvm/Support/JSON.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include "Utils/Tool/APISpec.h"
+
+using namespace llvm;
+
+bool APISpec::loadSpecFile(const string& path, bool optional) {
+    ErrorOr<unique_ptr<MemoryBuffer>> buffer = MemoryBuffer::getFile(path);
+    if (!buffer && optional && buffer.getError() == errc::no_such_file_or_directory) {
+        errs() << "api spec file " << path << " not found, using built-in lists\n";
+        return true;
+    }
+    if (!buffer) {
+        errs() << "Error: Could not open api spec file: " << path << "\n";
+        return false;
+    }
+
+    Expected<json::Value> parsed = json::parse((*buffer)->getBuffer());
+    if (!parsed) {
+        errs() << "api spec parse error: " << toString(parsed.takeError()) << "\n";
+        return false;
+    }
+    json::Object* obj = parsed->getAsObject();
+    if (!obj) {
+        errs() << "api spec is not a JSON object: " << path << "\n";
+        return false;
+    }
+
+    // 文件中给出的类别覆盖内置列表
+    auto loadNames = [obj](StringRef category, set<string>& names) {
+        json::Array* arr = obj->getArray(category);
+        if (!arr)
+            return true;
+        names.clear();
+        for (const json::Value& item: *arr) {
+            Optional<StringRef> name = item.getAsString();
+            if (!name) {
+                errs() << "api spec: non-string entry in " << category << "\n";
+                return false;
+            }
+            names.insert(name->str());
+        }
+        return true;
+    };
+
+    return loadNames("alloc", allocNames) && loadNames("copy", copyNames) &&
+           loadNames("dealloc", deallocNames) && loadNames("sensitive", sensitiveNames);
+}
+
+void APISpec::resolve(const ModuleList& modules) {
+    roles.clear();
+    // collect internal defined function names
+    for (const auto& item: modules) {
+        for (Function& F: *item.first) {
+            if (!F.isDeclaration())
+                allocNames.erase(F.getName().str());
+        }
+    }
+
+    for (const auto& item: modules) {
+        for (Function& F: *item.first) {
+            string name = F.getName().str();
+            unsigned role = 0;
+            if (allocNames.count(name))
+                role |= AllocAPI;
+            if (copyNames.count(name))
+                role |= CopyAPI;
+            if (deallocNames.count(name))
+                role |= DeallocAPI;
+            if (sensitiveNames.count(name))
+                role |= SensitiveAPI;
+            if (role)
+                roles[&F] = role;
+        }
+    }
+    resolved = true;
+}
@@ -0,0 +1,55 @@
+//
+// Created on 2026/10/19.
+//
+
+#include "Utils/Basic/Tarjan.h"
+#include "Utils/Tool/CallGraphSCC.h"
+#include "Utils/Tool/Common.h"
+
+void CallGraphSCC::build(const FrozenCallGraph& CG, vector<vector<Function*>>& SCC) {
+    unsigned numFuncs = CG.getNumFunctions();
+    // 只划分出现在调用边上的函数
+    auto succs = [&CG](unsigned id) { return CG.calleeIDs(id); };
+    auto isNode = [&CG](unsigned id) { return !CG.calleeIDs(id).empty() || !CG.callerIDs(id).empty(); };
+    Tarjan tarjan(numFuncs, succs, isNode);
+    vector<vector<unsigned>> sccIDs;
+    tarjan.getSCC(sccIDs);
+    OP << "partition size : " << tarjan.partitions << ", sccSize = " << tarjan.sccSize << ", rec size = "
+       << tarjan.rec << ", biggest = " << tarjan.biggest << "\n";
+
+    unsigned numSCCs = sccIDs.size();
+    SCC.assign(numSCCs, vector<Function*>());
+    sccOf.assign(numFuncs, InvalidSCC);
+    for (unsigned i = 0; i < numSCCs; ++i) {
+        for (unsigned id: sccIDs[i]) {
+            sccOf[id] = i;
+            SCC[i].push_back(CG.getFunction(id));
+        }
+    }
+
+    sccCallees.assign(numSCCs, vector<unsigned>());
+    sccCallers.assign(numSCCs, vector<unsigned>());
+    for (unsigned i = 0; i < numSCCs; ++i) {
+        vector<unsigned>& callees = sccCallees[i];
+        for (unsigned id: sccIDs[i])
+            for (unsigned calleeID: CG.calleeIDs(id))
+                if (sccOf[calleeID] != i)
+                    callees.push_back(sccOf[calleeID]);
+        llvm::sort(callees);
+        callees.erase(unique(callees.begin(), callees.end()), callees.end());
+        for (unsigned callee: callees)
+            sccCallers[callee].push_back(i);
+    }
+
+    // 逆拓扑序下callee SCC的下标总是更小，顺序扫描即可得到层次
+    levels.assign(numSCCs, 0);
+    levelSCCs.clear();
+    for (unsigned i = 0; i < numSCCs; ++i) {
+        for (unsigned callee: sccCallees[i])
+            levels[i] = max(levels[i], levels[callee] + 1);
+        if (levels[i] >= levelSCCs.size())
+            levelSCCs.resize(levels[i] + 1);
+        levelSCCs[levels[i]].push_back(i);
+    }
+    built = true;
+}
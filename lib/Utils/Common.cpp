@@ -296,7 +296,7 @@ void dumpAllocationWrapperInfo(map<Function*, set<CallBase*>>& function2AllocCal
             string callLoc = "{ \"ln\": " + itostr(CI->getDebugLoc()->getLine()) +
                              ", \"cl\": " + itostr(CI->getDebugLoc()->getColumn()) +
                              R"(, "fl": ")" + CI->getDebugLoc()->getFilename().str() + "\" }+";
-            for (Function* _Callee: Ctx->Callees[CI]) {
+            for (Function* _Callee: Ctx->CG.callees(CI)) {
                 string callKey = callLoc + removeFuncNumberSuffix(_Callee->getName().str());
                 *out << funcKey << "|" << callKey << "\n";
             }
@@ -5,4 +5,5 @@
 #include "Utils/Basic/Config.h"
 
 bool debug_mode = false;
-int max_type_layer = 10;
\ No newline at end of file
+int max_type_layer = 10;
+unsigned analysis_threads = 0;
\ No newline at end of file
@@ -0,0 +1,147 @@
+//
+// Created on 2026/10/19.
+//
+
+#include <llvm/Support/MathExtras.h>
+
+#include "Utils/Tool/FrozenCallGraph.h"
+
+// 把一组按源节点编号的邻居集合压缩为CSR
+template <typename GetRow>
+static void buildCSR(unsigned numNodes, GetRow getRow, vector<unsigned>& offsets, vector<FrozenCallGraph::NodeID>& edges) {
+    offsets.assign(numNodes + 1, 0);
+    edges.clear();
+    for (unsigned id = 0; id < numNodes; ++id) {
+        offsets[id] = edges.size();
+        getRow(id, edges);
+    }
+    offsets[numNodes] = edges.size();
+    edges.shrink_to_fit();
+}
+
+void FrozenCallGraph::build(const ModuleList& modules, const FunctionFacts& facts, const CalleeMap& callees, const CallerMap& callers,
+                            const CallMap& callMaps, const CalledMap& calledMaps) {
+    funcs.clear();
+    funcIDs.clear();
+    callsites.clear();
+    callsiteIDs.clear();
+    callsiteOwners.clear();
+
+    auto addFunction = [this](Function* F) {
+        auto ret = funcIDs.insert(make_pair(F, (NodeID) funcs.size()));
+        if (ret.second)
+            funcs.push_back(F);
+        return ret.first->second;
+    };
+
+    // 按模块、函数、指令顺序编号
+    for (const auto& item: modules) {
+        for (Function& F: *item.first) {
+            NodeID FID = addFunction(&F);
+            if (F.isDeclaration())
+                continue;
+            for (CallBase* CI: facts.callsites(&F)) {
+                callsiteIDs[CI] = callsites.size();
+                callsites.push_back(CI);
+                callsiteOwners.push_back(FID);
+            }
+        }
+    }
+    // map中出现但不属于任何模块的函数排在最后
+    for (CallBase* CI: callsites) {
+        auto it = callees.find(CI);
+        if (it != callees.end())
+            for (Function* F: it->second)
+                addFunction(F);
+    }
+    for (unsigned id = 0; id < funcs.size(); ++id) {
+        auto it = callMaps.find(funcs[id]);
+        if (it != callMaps.end())
+            for (Function* F: it->second)
+                addFunction(F);
+        auto CIt = calledMaps.find(funcs[id]);
+        if (CIt != calledMaps.end())
+            for (Function* F: CIt->second)
+                addFunction(F);
+    }
+    funcs.shrink_to_fit();
+
+    unsigned numFuncs = funcs.size();
+    buildCSR(numFuncs, [&](NodeID id, vector<NodeID>& edges) {
+        auto it = callMaps.find(funcs[id]);
+        if (it != callMaps.end())
+            for (Function* F: it->second)
+                edges.push_back(funcIDs.lookup(F));
+    }, calleeFuncCSR.offsets, calleeFuncCSR.edges);
+    buildCSR(numFuncs, [&](NodeID id, vector<NodeID>& edges) {
+        auto it = calledMaps.find(funcs[id]);
+        if (it != calledMaps.end())
+            for (Function* F: it->second)
+                edges.push_back(funcIDs.lookup(F));
+    }, callerFuncCSR.offsets, callerFuncCSR.edges);
+    buildCSR(callsites.size(), [&](NodeID id, vector<NodeID>& edges) {
+        auto it = callees.find(callsites[id]);
+        if (it != callees.end())
+            for (Function* F: it->second)
+                edges.push_back(funcIDs.lookup(F));
+    }, callsiteCalleeCSR.offsets, callsiteCalleeCSR.edges);
+    buildCSR(numFuncs, [&](NodeID id, vector<NodeID>& edges) {
+        auto it = callers.find(funcs[id]);
+        if (it != callers.end())
+            for (CallBase* CI: it->second) {
+                auto CIt = callsiteIDs.find(CI);
+                if (CIt != callsiteIDs.end())
+                    edges.push_back(CIt->second);
+            }
+    }, callerCallsiteCSR.offsets, callerCallsiteCSR.edges);
+
+    built = true;
+}
+
+size_t FrozenCallGraph::memorySize() const {
+    return funcs.capacity() * sizeof(Function*) + funcIDs.getMemorySize() +
+           callsites.capacity() * sizeof(CallBase*) + callsiteIDs.getMemorySize() +
+           callsiteOwners.capacity() * sizeof(NodeID) +
+           calleeFuncCSR.memorySize() + callerFuncCSR.memorySize() +
+           callsiteCalleeCSR.memorySize() + callerCallsiteCSR.memorySize();
+}
+
+// SmallPtrSet超过inline容量后改用堆上的开放寻址表
+template <typename PtrSet>
+static size_t ptrSetHeapSize(const PtrSet& S) {
+    if (S.size() <= 8)
+        return 0;
+    return NextPowerOf2(S.size() * 4 / 3) * sizeof(void*);
+}
+
+template <typename Map>
+static size_t denseMapOfSetsSize(const Map& M) {
+    size_t size = M.getMemorySize();
+    for (const auto& item: M)
+        size += ptrSetHeapSize(item.second);
+    return size;
+}
+
+void FrozenCallGraph::printMemoryReport(raw_ostream& os, const CalleeMap& callees, const CallerMap& callers,
+                                        const CallMap& callMaps, const CalledMap& calledMaps) const {
+    size_t calleeMapSize = denseMapOfSetsSize(callees);
+    size_t callerMapSize = denseMapOfSetsSize(callers);
+    size_t calledMapSize = denseMapOfSetsSize(calledMaps);
+    // unordered_map节点: next指针 + 缓存的hash + pair，std::set节点: 红黑树头部 + 元素
+    size_t callMapSize = callMaps.bucket_count() * sizeof(void*) +
+                         callMaps.size() * (sizeof(CallMap::value_type) + 2 * sizeof(void*));
+    for (const auto& item: callMaps)
+        callMapSize += item.second.size() * (32 + sizeof(Function*));
+    size_t mapsSize = calleeMapSize + callerMapSize + callMapSize + calledMapSize;
+
+    auto toKB = [](size_t bytes) { return (bytes + 1023) / 1024; };
+    os << "############## Call Graph Memory ##############\n";
+    os << "# functions: " << getNumFunctions() << ", callsites: " << getNumCallsites()
+       << ", function edges: " << getNumEdges() << "\n";
+    os << "# freed Callees map (estimated): \t" << toKB(calleeMapSize) << " KB\n";
+    os << "# freed Callers map (estimated): \t" << toKB(callerMapSize) << " KB\n";
+    os << "# freed CallMaps (estimated): \t" << toKB(callMapSize) << " KB\n";
+    os << "# freed CalledMaps (estimated): \t" << toKB(calledMapSize) << " KB\n";
+    os << "# freed maps in total (estimated): \t" << toKB(mapsSize) << " KB\n";
+    os << "# frozen CSR graph (kept): \t" << toKB(memorySize()) << " KB\n";
+}
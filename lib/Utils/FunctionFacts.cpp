@@ -0,0 +1,43 @@
+//
+// Created on 2026/10/19.
+//
+
+#include <llvm/IR/InstIterator.h>
+
+#include "Utils/Tool/FunctionFacts.h"
+#include "Utils/Tool/Parallel.h"
+
+void FunctionFacts::collect(Function* F, FunctionFactTable& table) {
+    for (inst_iterator i = inst_begin(F), e = inst_end(F); i != e; ++i) {
+        Instruction* I = &*i;
+        if (CallBase* CI = dyn_cast<CallBase>(I))
+            table.callsites.push_back(CI);
+        else if (StoreInst* SI = dyn_cast<StoreInst>(I))
+            table.stores.push_back(SI);
+        else if (ReturnInst* RI = dyn_cast<ReturnInst>(I))
+            table.returns.push_back(RI);
+
+        for (unsigned ii = 0; ii < I->getNumOperands(); ++ii)
+            if (GlobalVariable* GV = dyn_cast<GlobalVariable>(I->getOperand(ii)))
+                table.globalUses.push_back(make_pair(I, GV));
+    }
+}
+
+void FunctionFacts::build(const ModuleList& modules) {
+    // 先按模块、函数顺序编号，再并行填表
+    vector<Function*> funcs;
+    for (const auto& item: modules) {
+        for (Function& F: *item.first) {
+            if (F.isDeclaration())
+                continue;
+            funcIndex[&F] = funcs.size();
+            funcs.push_back(&F);
+        }
+    }
+
+    tables.assign(funcs.size(), FunctionFactTable());
+    parallelFor(funcs.size(), [&](size_t i) {
+        collect(funcs[i], tables[i]);
+    });
+    built = true;
+}
@@ -0,0 +1,37 @@
+//
+// Created on 2026/10/19.
+//
+
+#include <llvm/ADT/StringExtras.h>
+#include <llvm/IR/DebugInfoMetadata.h>
+
+#include "Utils/Tool/FunctionKeyIndex.h"
+#include "Utils/Tool/Common.h"
+
+string FunctionKeyIndex::getKey(const string& funcName, const string& fileName, unsigned line) {
+    return funcName + "<" + fileName + "<" + utostr(line);
+}
+
+string FunctionKeyIndex::getKey(const Function* F) {
+    const DISubprogram* SP = F->getSubprogram();
+    return getKey(removeFuncNumberSuffix(F->getName().str()), SP->getFilename().str(), SP->getLine());
+}
+
+void FunctionKeyIndex::build(const ModuleList& modules) {
+    index.clear();
+    for (const auto& item: modules) {
+        for (const Function& F: *item.first) {
+            const DISubprogram* SP = F.getSubprogram();
+            if (!SP)
+                continue;
+            index[getKey(&F)].push_back(&F);
+        }
+    }
+}
+
+ArrayRef<const Function*> FunctionKeyIndex::lookup(const string& funcName, const string& fileName, unsigned line) const {
+    auto it = index.find(getKey(funcName, fileName, line));
+    if (it == index.end())
+        return ArrayRef<const Function*>();
+    return it->second;
+}
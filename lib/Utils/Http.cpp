@@ -3,6 +3,8 @@
 //
 
 #include <curl/curl.h>
+#include <mutex>
+#include <vector>
 #include "Utils/Tool/Http.h"
 
 size_t WriteCallback(void* contents, size_t size, size_t nmemb, string* s) {
@@ -10,30 +12,113 @@ size_t WriteCallback(void* contents, size_t size, size_t nmemb, string* s) {
     s->append((char*)contents, newLength);
     return newLength;
 }
-// 省略其他代码，和之前类似
 
+// 返回非0时curl中止传输
+int CancelCallback(void* clientp, curl_off_t dltotal, curl_off_t dlnow, curl_off_t ultotal, curl_off_t ulnow) {
+    return static_cast<const atomic<bool>*>(clientp)->load() ? 1 : 0;
+}
 
-// HTTP GET请求，成功返回true，结果解析到out_json
-bool httpGet(const string& url, json& out_json) {
-    CURL* curl = curl_easy_init();
-    if (!curl) {
-        return false;
+namespace {
+// 复用的curl easy handle池，每个handle保留与服务器之间的keep-alive连接
+// 并发请求各自借用一个handle，池的大小随最大并发数增长
+class CurlHandlePool {
+private:
+    mutex poolMutex;
+    vector<CURL*> idleHandles;
+    curl_slist* jsonHeaders = nullptr;
+
+public:
+    HttpStats stats;
+
+    CurlHandlePool() {
+        curl_global_init(CURL_GLOBAL_DEFAULT);
+        jsonHeaders = curl_slist_append(jsonHeaders, "Content-Type: application/json");
+    }
+
+    ~CurlHandlePool() {
+        for (CURL* curl: idleHandles)
+            curl_easy_cleanup(curl);
+        curl_slist_free_all(jsonHeaders);
+        curl_global_cleanup();
+    }
+
+    const curl_slist* getJsonHeaders() const { return jsonHeaders; }
+
+    // reset只清除选项，handle中缓存的连接仍可复用
+    CURL* acquire() {
+        {
+            lock_guard<mutex> lock(poolMutex);
+            if (!idleHandles.empty()) {
+                CURL* curl = idleHandles.back();
+                idleHandles.pop_back();
+                curl_easy_reset(curl);
+                return curl;
+            }
+        }
+        return curl_easy_init();
+    }
+
+    void release(CURL* curl) {
+        lock_guard<mutex> lock(poolMutex);
+        idleHandles.push_back(curl);
+    }
+
+    void record(const HttpTiming& timing) {
+        lock_guard<mutex> lock(poolMutex);
+        stats.requestNum += 1;
+        stats.newConnectionNum += timing.newConnections;
+        stats.connectMs += timing.connectMs;
+        stats.totalMs += timing.totalMs;
+    }
+
+    HttpStats getStats() {
+        lock_guard<mutex> lock(poolMutex);
+        return stats;
     }
+};
+
+CurlHandlePool& getHandlePool() {
+    static CurlHandlePool pool;
+    return pool;
+}
 
+// 执行请求并解析json响应，handle使用后归还到池中
+bool performJsonRequest(CURL* curl, const string& url, json& out_json, HttpTiming* timing) {
+    CurlHandlePool& pool = getHandlePool();
     string response_data;
     curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
     curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
     curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response_data);
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+    // 多线程下不能使用信号实现超时
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
 
     CURLcode res = curl_easy_perform(curl);
     long http_code = 0;
     curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
 
-    curl_easy_cleanup(curl);
+    // connect time为0说明复用了已有连接
+    HttpTiming curTiming;
+    curTiming.status = http_code;
+    curl_off_t retryAfter = 0;
+    if (curl_easy_getinfo(curl, CURLINFO_RETRY_AFTER, &retryAfter) == CURLE_OK)
+        curTiming.retryAfterSec = retryAfter;
+    long connects = 0;
+    double connectSec = 0, totalSec = 0;
+    curl_easy_getinfo(curl, CURLINFO_NUM_CONNECTS, &connects);
+    curl_easy_getinfo(curl, CURLINFO_CONNECT_TIME, &connectSec);
+    curl_easy_getinfo(curl, CURLINFO_TOTAL_TIME, &totalSec);
+    curTiming.newConnections = connects;
+    curTiming.connectMs = connectSec * 1000;
+    curTiming.totalMs = totalSec * 1000;
+    pool.record(curTiming);
+    if (timing)
+        *timing = curTiming;
+
+    pool.release(curl);
 
     if (res != CURLE_OK)
         return false;
-
     if (http_code != 200)
         return false;
 
@@ -44,41 +129,34 @@ bool httpGet(const string& url, json& out_json) {
     }
     return true;
 }
+}
+
+// HTTP GET请求，成功返回true，结果解析到out_json
+bool httpGet(const string& url, json& out_json, HttpTiming* timing) {
+    CURL* curl = getHandlePool().acquire();
+    if (!curl)
+        return false;
+    return performJsonRequest(curl, url, out_json, timing);
+}
 
 // HTTP POST请求，发送json格式payload，成功返回true，响应json解析到out_json
-bool httpPost(const string& url, const json& payload, json& out_json) {
-    CURL* curl = curl_easy_init();
+bool httpPost(const string& url, const json& payload, json& out_json, HttpTiming* timing,
+              const atomic<bool>* cancelled) {
+    CURL* curl = getHandlePool().acquire();
     if (!curl)
         return false;
 
-    string response_data;
     string payload_str = payload.dump();
-
-    struct curl_slist* headers = nullptr;
-    headers = curl_slist_append(headers, "Content-Type: application/json");
-
-    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
     curl_easy_setopt(curl, CURLOPT_POSTFIELDS, payload_str.c_str());
-    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response_data);
-
-    CURLcode res = curl_easy_perform(curl);
-    long http_code = 0;
-    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
-
-    curl_slist_free_all(headers);
-    curl_easy_cleanup(curl);
-
-    if (res != CURLE_OK)
-        return false;
-    if (http_code != 200)
-        return false;
-
-    try {
-        out_json = json::parse(response_data);
-    } catch (const exception& e) {
-        return false;
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, getHandlePool().getJsonHeaders());
+    if (cancelled) {
+        curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+        curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, CancelCallback);
+        curl_easy_setopt(curl, CURLOPT_XFERINFODATA, cancelled);
     }
-    return true;
-}
\ No newline at end of file
+    return performJsonRequest(curl, url, out_json, timing);
+}
+
+HttpStats getHttpStats() {
+    return getHandlePool().getStats();
+}
@@ -0,0 +1,108 @@
+//
+// Created on 2026/10/19.
+//
+
+#include <llvm/IR/CFG.h>
+
+#include "Utils/Basic/LoopAnalysis.h"
+
+// 迭代DFS，遇到指向栈中基本块的边即存在环
+bool LoopAnalysisCache::detectCycle(const Function* F) {
+    if (F->isDeclaration())
+        return false;
+    // 0: 未访问, 1: 在栈中, 2: 已完成
+    DenseMap<const BasicBlock*, int> state;
+    SmallVector<pair<const BasicBlock*, const_succ_iterator>, 16> stack;
+    const BasicBlock* entry = &F->getEntryBlock();
+    state[entry] = 1;
+    stack.push_back(make_pair(entry, succ_begin(entry)));
+    while (!stack.empty()) {
+        const BasicBlock* BB = stack.back().first;
+        const_succ_iterator& it = stack.back().second;
+        if (it == succ_end(BB)) {
+            state[BB] = 2;
+            stack.pop_back();
+            continue;
+        }
+        const BasicBlock* succ = *it;
+        ++it;
+        int& succState = state[succ];
+        if (succState == 1)
+            return true;
+        if (succState == 0) {
+            succState = 1;
+            stack.push_back(make_pair(succ, succ_begin(succ)));
+        }
+    }
+    return false;
+}
+
+LoopAnalysisCache::FunctionLoopInfo& LoopAnalysisCache::getInfo(const Function* F) {
+    unique_ptr<FunctionLoopInfo>& info = cache[F];
+    if (!info) {
+        info = make_unique<FunctionLoopInfo>();
+        info->hasLoop = detectCycle(F);
+    }
+    return *info;
+}
+
+void LoopAnalysisCache::buildAcyclicView(const Function* F, FunctionLoopInfo& info) {
+    info.viewBuilt = true;
+    if (!info.hasLoop)
+        return;
+    DominatorTree DT(const_cast<Function&>(*F));
+    LoopInfo LI(DT);
+
+    // 视图中的后继，已处理的latch读取重定向后的结果
+    auto viewSuccessor = [&info](const Instruction* TI, unsigned idx) {
+        if (idx == 0) {
+            auto it = info.redirectedSuccs.find(TI);
+            if (it != info.redirectedSuccs.end())
+                return it->second;
+        }
+        return TI->getSuccessor(idx);
+    };
+
+    for (Loop* LP: LI.getLoopsInPreorder()) {
+        BasicBlock* HeaderB = LP->getHeader();
+        SmallVector<BasicBlock*, 4> LatchBS;
+        LP->getLoopLatches(LatchBS);
+        for (BasicBlock* LatchB: LatchBS) {
+            const Instruction* TI = LatchB->getTerminator();
+            const Instruction* HeaderTI = HeaderB->getTerminator();
+            // Case 1: latch只有一个后继(for/while循环)，重定向到header中不支配latch的那条出边
+            if (TI->getNumSuccessors() == 1) {
+                for (unsigned i = 0; i < HeaderTI->getNumSuccessors(); ++i) {
+                    BasicBlock* SuccB = viewSuccessor(HeaderTI, i);
+                    if (DT.dominates(BasicBlockEdge(HeaderB, SuccB), LatchB))
+                        continue;
+                    info.redirectedSuccs[TI] = SuccB;
+                }
+            }
+            // Case 2: latch有两个后继(do-while循环)，重定向到header以外的后继
+            else {
+                for (unsigned i = 0; i < TI->getNumSuccessors(); ++i) {
+                    BasicBlock* SuccB = viewSuccessor(TI, i);
+                    if (SuccB == HeaderB)
+                        continue;
+                    info.redirectedSuccs[TI] = SuccB;
+                }
+            }
+        }
+    }
+}
+
+BasicBlock* LoopAnalysisCache::getSuccessor(const Instruction* TI, unsigned idx) {
+    if (idx == 0) {
+        lock_guard<mutex> lock(cacheMutex);
+        FunctionLoopInfo& info = getInfo(TI->getFunction());
+        if (info.hasLoop) {
+            if (!info.viewBuilt)
+                buildAcyclicView(TI->getFunction(), info);
+            auto it = info.redirectedSuccs.find(TI);
+            if (it != info.redirectedSuccs.end())
+                return it->second;
+        }
+    }
+    return TI->getSuccessor(idx);
+}
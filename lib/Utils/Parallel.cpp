@@ -0,0 +1,55 @@
+//
+// Created on 2026/10/19.
+//
+
+#include <llvm/Support/ThreadPool.h>
+#include <llvm/Support/Threading.h>
+
+#include <atomic>
+#include <vector>
+
+#include "Utils/Basic/Config.h"
+#include "Utils/Tool/Parallel.h"
+
+using namespace std;
+
+// set on pool workers, nested parallelFor calls must not wait on the pool they are running on
+static thread_local bool inParallelWorker = false;
+
+unsigned getAnalysisThreadNum() {
+    return hardware_concurrency(analysis_threads).compute_thread_count();
+}
+
+static ThreadPool& getAnalysisPool() {
+    // created on first use so that analysis_threads has been set by the tool
+    static ThreadPool pool(hardware_concurrency(analysis_threads));
+    return pool;
+}
+
+void parallelFor(size_t N, function_ref<void(size_t)> Fn) {
+    unsigned threadNum = getAnalysisThreadNum();
+    if (N <= 1 || threadNum <= 1 || inParallelWorker) {
+        for (size_t i = 0; i < N; ++i)
+            Fn(i);
+        return;
+    }
+
+    // workers pull indexes from a shared counter, the calling thread works as well
+    atomic<size_t> next(0);
+    auto work = [&]() {
+        bool saved = inParallelWorker;
+        inParallelWorker = true;
+        for (size_t i = next++; i < N; i = next++)
+            Fn(i);
+        inParallelWorker = saved;
+    };
+
+    ThreadPool& pool = getAnalysisPool();
+    size_t helperNum = min<size_t>(threadNum, N) - 1;
+    vector<shared_future<void>> futures;
+    for (size_t i = 0; i < helperNum; ++i)
+        futures.push_back(pool.async(work));
+    work();
+    for (shared_future<void>& f: futures)
+        f.wait();
+}
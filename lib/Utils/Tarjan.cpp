@@ -3,56 +3,66 @@
 //
 
 #include "Utils/Basic/Tarjan.h"
-#include "Utils/Tool/Common.h"
-
-
-void Tarjan::dfs(Function *F) {
-    dfn[F] = low[F] = ts++;
-    depVisit.insert(F);
-    Stack.push(F);
-    inStack[F] = true;
-    for (auto iter: depCG[F]) {
-        Function *func = iter;
-        if (!depVisit.count(func)) {
-            dfs(func);
-            if (low[func] < low[F])
-                low[F] = low[func];
-        } else {
-            if (dfn[func] < low[F] && inStack[func])
-                low[F] = dfn[func];
-        }
-    }
 
-    Function* temp = NULL;
-    sc.clear();
-    if (dfn[F] == low[F]) {
-        do {
-            temp = Stack.top();
-            sc.push_back(temp);
-            Stack.pop();
-            inStack[temp] = false;
-        } while (temp != F);
-
-        SCC.push_back(sc);
-        int n = sc.size();
-        if (n > biggest) biggest = n;
-        if (sc.size() == 1 && depCG[sc.back()].count(sc.back())) {
-            rec++;
-        }
-        sccSize += sc.size();
-    }
-}
 
-void Tarjan::getSCC(vector<vector<Function*>> &ans) {
-    int count = 0;
-    for (auto iter : funcs) {
-        Function *cur = iter;
-        if (depVisit.count(cur))
+void Tarjan::getSCC(vector<vector<unsigned>>& ans) {
+    ans.clear();
+    // dfn为0表示未访问
+    vector<unsigned> dfn(N, 0), low(N, 0);
+    vector<bool> inStack(N, false);
+    vector<unsigned> Stack;
+    // 模拟递归的调用栈: (节点, 下一条待访问出边)
+    vector<pair<unsigned, unsigned>> callStack;
+    unsigned ts = 1;
+
+    auto visit = [&](unsigned v) {
+        dfn[v] = low[v] = ts++;
+        Stack.push_back(v);
+        inStack[v] = true;
+        callStack.push_back(make_pair(v, 0));
+    };
+
+    for (unsigned root = 0; root < N; ++root) {
+        if (dfn[root] || !isNode(root))
             continue;
-        dfs(cur);
-        count++;
+        ++partitions;
+        visit(root);
+        while (!callStack.empty()) {
+            unsigned v = callStack.back().first;
+            ArrayRef<unsigned> vSuccs = succs(v);
+            if (callStack.back().second < vSuccs.size()) {
+                unsigned w = vSuccs[callStack.back().second++];
+                if (!dfn[w])
+                    visit(w);
+                else if (inStack[w] && dfn[w] < low[v])
+                    low[v] = dfn[w];
+                continue;
+            }
+
+            callStack.pop_back();
+            if (!callStack.empty()) {
+                unsigned u = callStack.back().first;
+                if (low[v] < low[u])
+                    low[u] = low[v];
+            }
+            if (dfn[v] != low[v])
+                continue;
+
+            vector<unsigned> sc;
+            unsigned temp;
+            do {
+                temp = Stack.back();
+                Stack.pop_back();
+                inStack[temp] = false;
+                sc.push_back(temp);
+            } while (temp != v);
+
+            if (sc.size() > biggest)
+                biggest = sc.size();
+            if (sc.size() == 1 && is_contained(vSuccs, v))
+                rec++;
+            sccSize += sc.size();
+            ans.push_back(std::move(sc));
+        }
     }
-    ans = SCC;
-    OP << "partition size : " << count << ", sccSize = " << sccSize << ", rec size = " << rec << ", biggest = "
-           << biggest << "\n";
-}
\ No newline at end of file
+}
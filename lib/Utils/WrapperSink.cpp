@@ -0,0 +1,70 @@
+//
+// Created on 2026/10/19.
+//
+
+#include <llvm/IR/DebugInfoMetadata.h>
+#include <llvm/Support/JSON.h>
+
+#include <chrono>
+
+#include "Utils/Tool/WrapperSink.h"
+#include "Utils/Tool/FunctionKeyIndex.h"
+#include "Utils/Tool/Common.h"
+
+bool WrapperSink::open(const string& path) {
+    out.open(path, ios::out | ios::app);
+    if (!out.is_open()) {
+        OP << "cannot open wrapper stream file: " << path << "\n";
+        return false;
+    }
+    return true;
+}
+
+void WrapperSink::emit(const string& pass, const Function* F, const set<CallBase*>& calls, const FrozenCallGraph& CG) {
+    if (!out.is_open() || !F->getSubprogram())
+        return;
+
+    // set<CallBase*>按指针排序，按(file, line, col, callees)排序使输出稳定
+    vector<pair<tuple<string, unsigned, unsigned, string>, json::Object>> sortedCalls;
+    for (CallBase* CI: calls) {
+        json::Array callees;
+        string calleeNames;
+        for (Function* callee: CG.callees(CI)) {
+            string name = removeFuncNumberSuffix(callee->getName().str());
+            calleeNames += name + ",";
+            callees.push_back(name);
+        }
+        json::Object call{{"callees", std::move(callees)}};
+        string file;
+        unsigned line = 0, col = 0;
+        if (const DebugLoc& loc = CI->getDebugLoc()) {
+            file = loc->getFilename().str();
+            line = loc.getLine();
+            col = loc.getCol();
+            call["file"] = file;
+            call["line"] = line;
+            call["col"] = col;
+        }
+        sortedCalls.emplace_back(make_tuple(file, line, col, calleeNames), std::move(call));
+    }
+    stable_sort(sortedCalls.begin(), sortedCalls.end(),
+                [](const auto& a, const auto& b) { return a.first < b.first; });
+    json::Array callArr;
+    for (auto& item: sortedCalls)
+        callArr.push_back(std::move(item.second));
+
+    int64_t ts = chrono::duration_cast<chrono::milliseconds>(
+            chrono::system_clock::now().time_since_epoch()).count();
+    json::Object record{{"key", FunctionKeyIndex::getKey(F)}, {"calls", std::move(callArr)},
+                        {"pass", pass}, {"ts", ts}};
+
+    string line;
+    raw_string_ostream os(line);
+    os << json::Value(std::move(record));
+    os.flush();
+
+    lock_guard<mutex> lock(sinkMutex);
+    out << line << "\n";
+    out.flush();
+    ++NumRecords;
+}
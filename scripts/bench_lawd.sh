@@ -0,0 +1,110 @@
+#!/usr/bin/env bash
+#
+# Created on 2026/10/19.
+#
+# Offline benchmark of lawd against scripts/mock_llm_server.py.
+# lawd runs twice on the same inputs: first with a zero-latency server, which measures the non-LLM overhead
+# (bitcode loading, call graph, prompt building, scheduling), then with the given model latency.
+#
+# usage: bench_lawd.sh [-p port] [-m latency_ms] [-j jitter_ms] [-r replay_file] [-c concurrency]
+#                      <lawd> <source_info> <template_file> <bc_file>... [-- <extra lawd args>]
+
+set -euo pipefail
+
+PORT=18930
+LATENCY_MS=300
+JITTER_MS=0
+REPLAY=""
+CONCURRENCY=16
+while getopts "p:m:j:r:c:" opt; do
+    case $opt in
+        p) PORT=$OPTARG ;;
+        m) LATENCY_MS=$OPTARG ;;
+        j) JITTER_MS=$OPTARG ;;
+        r) REPLAY=$OPTARG ;;
+        c) CONCURRENCY=$OPTARG ;;
+        *) sed -n '8,9p' "$0"; exit 1 ;;
+    esac
+done
+shift $((OPTIND - 1))
+if [ $# -lt 4 ]; then
+    sed -n '8,9p' "$0"
+    exit 1
+fi
+
+LAWD=$1
+SOURCE_INFO=$2
+TEMPLATE=$3
+shift 3
+BC_FILES=()
+while [ $# -gt 0 ] && [ "$1" != "--" ]; do
+    BC_FILES+=("$1")
+    shift
+done
+[ $# -gt 0 ] && shift
+EXTRA_ARGS=("$@")
+
+SCRIPT_DIR=$(cd "$(dirname "$0")" && pwd)
+WORK_DIR=$(mktemp -d)
+SERVER_PID=""
+cleanup() {
+    [ -n "$SERVER_PID" ] && kill "$SERVER_PID" 2>/dev/null || true
+    rm -rf "$WORK_DIR"
+}
+trap cleanup EXIT
+
+now_ms() {
+    echo $(($(date +%s%N) / 1000000))
+}
+
+start_server() {
+    local latency=$1
+    local replay_args=()
+    [ -n "$REPLAY" ] && replay_args=(--replay "$REPLAY")
+    python3 "$SCRIPT_DIR/mock_llm_server.py" --port "$PORT" --latency-ms "$latency" --jitter-ms "$JITTER_MS" \
+        "${replay_args[@]}" 2>/dev/null &
+    SERVER_PID=$!
+    for _ in $(seq 50); do
+        curl -sf "http://127.0.0.1:$PORT/v1/models" >/dev/null && return 0
+        sleep 0.1
+    done
+    echo "mock server did not start on port $PORT" >&2
+    exit 1
+}
+
+stop_server() {
+    kill "$SERVER_PID" 2>/dev/null || true
+    wait "$SERVER_PID" 2>/dev/null || true
+    SERVER_PID=""
+}
+
+# run_lawd <name> <latency_ms>
+run_lawd() {
+    local name=$1
+    start_server "$2"
+    local log="$WORK_DIR/$name.log"
+    local start end
+    start=$(now_ms)
+    "$LAWD" -source-info-file="$SOURCE_INFO" -prompt-template-file="$TEMPLATE" -addr="127.0.0.1:$PORT" -log-dir= \
+        -llm-concurrency="$CONCURRENCY" -wrapper-output-file="$WORK_DIR/$name.txt" "${EXTRA_ARGS[@]}" \
+        "${BC_FILES[@]}" >"$log" 2>&1
+    end=$(now_ms)
+    local requests
+    requests=$(curl -sf "http://127.0.0.1:$PORT/stats" | python3 -c 'import json,sys; print(json.load(sys.stdin)["requests"])')
+    stop_server
+
+    local wall=$((end - start))
+    local wrappers
+    wrappers=$(grep -c . "$WORK_DIR/$name.txt" || true)
+    echo "$name: latency ${2} ms, wall ${wall} ms, server requests ${requests}, wrapper lines ${wrappers}," \
+        "requests/s $(awk -v r="$requests" -v w="$wall" 'BEGIN { printf "%.1f", (w > 0 ? r * 1000 / w : 0) }')"
+    grep -E "analysis spent|LLM executor|LLM throttled|skipped votes" "$log" | sed 's/^/    /'
+    eval "${name}_WALL=$wall"
+}
+
+run_lawd offline 0
+run_lawd model "$LATENCY_MS"
+if ! cmp -s "$WORK_DIR/offline.txt" "$WORK_DIR/model.txt"; then
+    echo "warning: results differ between the two runs" >&2
+fi
+echo "non-LLM overhead: ${offline_WALL} ms, LLM wait: $((model_WALL - offline_WALL)) ms"
@@ -0,0 +1,228 @@
+#!/usr/bin/env python3
+#
+# Created on 2026/10/19.
+#
+# Deterministic stand-in for an OpenAI-compatible server, used to benchmark and regression-test lawd offline.
+# Only the standard library is used.
+#
+# Answers come from, in order:
+#   1. a replay file (--replay), recorded earlier with --record against a real server (--upstream);
+#      answers of the same prompt are returned in recorded order and cycle when the votes outnumber them
+#   2. the scripted policy (--policy) for prompts not in the replay file
+#
+# Endpoints: GET /v1/models, POST /v1/chat/completions (supports n), GET /stats.
+#
+# Examples:
+#   record:  mock_llm_server.py --port 18080 --upstream http://10.0.0.2:8000 --record answers.jsonl
+#   replay:  mock_llm_server.py --port 18080 --replay answers.jsonl --latency-ms 300 --jitter-ms 100
+#   scripted: mock_llm_server.py --port 18080 --policy hash --fail-every 50 --retry-after 1
+
+import argparse
+import hashlib
+import http.server
+import json
+import random
+import sys
+import threading
+import time
+import urllib.request
+
+
+def prompt_key(messages):
+    # 同一(system, user)prompt对应同一key
+    sys_prompt = ""
+    user_prompt = ""
+    for message in messages:
+        if message.get("role") == "system":
+            sys_prompt = message.get("content", "")
+        elif message.get("role") == "user":
+            user_prompt = message.get("content", "")
+    return hashlib.sha1(json.dumps([sys_prompt, user_prompt]).encode()).hexdigest(), sys_prompt, user_prompt
+
+
+class MockState:
+    def __init__(self, args):
+        self.args = args
+        self.lock = threading.Lock()
+        self.rng = random.Random(args.seed)
+        # key -> recorded answers
+        self.replay = {}
+        # key -> number of answers already returned
+        self.cursor = {}
+        self.stats = {"requests": 0, "completions": 0, "replayed": 0, "scripted": 0, "failures": 0, "upstream": 0}
+        self.record_file = open(args.record, "a") if args.record else None
+        if args.replay:
+            with open(args.replay) as f:
+                for line in f:
+                    line = line.strip()
+                    if not line:
+                        continue
+                    entry = json.loads(line)
+                    self.replay.setdefault(entry["key"], []).extend(entry["answers"])
+
+    def scripted_answer(self, user_prompt):
+        policy = self.args.policy
+        if policy == "yes" or policy == "no":
+            return policy
+        if policy == "hash":
+            # 与prompt绑定的固定答案
+            return "yes" if int(hashlib.md5(user_prompt.encode()).hexdigest(), 16) % 2 == 0 else "no"
+        # random
+        return "yes" if self.rng.random() < self.args.yes_ratio else "no"
+
+    def answers(self, key, user_prompt, n):
+        with self.lock:
+            recorded = self.replay.get(key)
+            if recorded:
+                start = self.cursor.get(key, 0)
+                self.cursor[key] = start + n
+                self.stats["replayed"] += n
+                return [recorded[(start + i) % len(recorded)] for i in range(n)]
+            self.stats["scripted"] += n
+            return [self.scripted_answer(user_prompt) for _ in range(n)]
+
+    def latency(self, prompt_tokens):
+        with self.lock:
+            jitter = self.rng.uniform(0, self.args.jitter_ms) if self.args.jitter_ms > 0 else 0
+        return (self.args.latency_ms + jitter + prompt_tokens * self.args.ms_per_token) / 1000
+
+    def record(self, key, answers):
+        if not self.record_file:
+            return
+        with self.lock:
+            self.record_file.write(json.dumps({"key": key, "answers": answers}) + "\n")
+            self.record_file.flush()
+
+
+class Handler(http.server.BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"
+    state = None
+
+    def log_message(self, fmt, *args):
+        if self.state.args.verbose:
+            sys.stderr.write("%s - %s\n" % (self.address_string(), fmt % args))
+
+    def send_json(self, obj, status=200, headers=None):
+        body = json.dumps(obj).encode()
+        self.send_response(status)
+        self.send_header("Content-Type", "application/json")
+        self.send_header("Content-Length", str(len(body)))
+        for name, value in (headers or {}).items():
+            self.send_header(name, value)
+        self.end_headers()
+        self.wfile.write(body)
+
+    def do_GET(self):
+        if self.path.rstrip("/") == "/stats":
+            with self.state.lock:
+                self.send_json(dict(self.state.stats))
+        elif self.path.rstrip("/") == "/v1/models":
+            self.send_json({"object": "list", "data": [{"id": self.state.args.model, "object": "model"}]})
+        else:
+            self.send_json({"error": "not found"}, 404)
+
+    def do_POST(self):
+        if self.path.rstrip("/") != "/v1/chat/completions":
+            self.send_json({"error": "not found"}, 404)
+            return
+        length = int(self.headers.get("Content-Length", 0))
+        try:
+            payload = json.loads(self.rfile.read(length))
+        except ValueError:
+            self.send_json({"error": "invalid json"}, 400)
+            return
+
+        state = self.state
+        args = state.args
+        with state.lock:
+            state.stats["requests"] += 1
+            request_idx = state.stats["requests"]
+        n = int(payload.get("n", 1))
+        if args.reject_n and n > 1:
+            self.send_json({"error": "n is not supported"}, 400)
+            return
+        if args.fail_every and request_idx % args.fail_every == 0:
+            with state.lock:
+                state.stats["failures"] += 1
+            self.send_json({"error": "server busy"}, 429, {"Retry-After": str(args.retry_after)})
+            return
+
+        key, sys_prompt, user_prompt = prompt_key(payload.get("messages", []))
+        prompt_tokens = (len(sys_prompt) + len(user_prompt)) // 4 + 1
+        if args.upstream:
+            self.proxy(payload, key)
+            return
+
+        time.sleep(state.latency(prompt_tokens))
+        answers = state.answers(key, user_prompt, n)
+        with state.lock:
+            state.stats["completions"] += n
+        choices = [{"index": i, "message": {"role": "assistant", "content": answer}, "finish_reason": "stop"}
+                   for i, answer in enumerate(answers)]
+        self.send_json({
+            "object": "chat.completion",
+            "model": args.model,
+            "choices": choices,
+            "usage": {"prompt_tokens": prompt_tokens,
+                      "completion_tokens": sum(len(answer) // 4 + 1 for answer in answers)}
+        })
+
+    def proxy(self, payload, key):
+        # 转发给真实服务器，并记录答案供之后回放
+        state = self.state
+        request = urllib.request.Request(state.args.upstream.rstrip("/") + "/v1/chat/completions",
+                                         data=json.dumps(payload).encode(),
+                                         headers={"Content-Type": "application/json"})
+        try:
+            with urllib.request.urlopen(request) as response:
+                resp = json.loads(response.read())
+        except Exception as e:
+            self.send_json({"error": "upstream failed: %s" % e}, 502)
+            return
+        with state.lock:
+            state.stats["upstream"] += 1
+            state.stats["completions"] += len(resp.get("choices", []))
+        state.record(key, [choice["message"]["content"] for choice in resp.get("choices", [])])
+        self.send_json(resp)
+
+
+class Server(http.server.ThreadingHTTPServer):
+    # lawd keeps up to -llm-concurrency connections open
+    request_queue_size = 128
+    daemon_threads = True
+
+
+def main():
+    parser = argparse.ArgumentParser(description="deterministic OpenAI-compatible mock server for lawd")
+    parser.add_argument("--host", default="127.0.0.1")
+    parser.add_argument("--port", type=int, default=18080)
+    parser.add_argument("--model", default="mock-model")
+    parser.add_argument("--replay", help="jsonl of recorded answers, one {\"key\", \"answers\"} per line")
+    parser.add_argument("--record", help="append answers of --upstream to this jsonl")
+    parser.add_argument("--upstream", help="base url of a real server to proxy to, e.g. http://127.0.0.1:8000")
+    parser.add_argument("--policy", choices=["yes", "no", "hash", "random"], default="hash",
+                        help="answer of prompts not in the replay file")
+    parser.add_argument("--yes-ratio", type=float, default=0.5, help="probability of yes for --policy random")
+    parser.add_argument("--seed", type=int, default=0)
+    parser.add_argument("--latency-ms", type=float, default=0, help="fixed latency of each completion")
+    parser.add_argument("--jitter-ms", type=float, default=0, help="uniform extra latency in [0, jitter]")
+    parser.add_argument("--ms-per-token", type=float, default=0, help="extra latency per prompt token")
+    parser.add_argument("--fail-every", type=int, default=0, help="answer every k-th request with 429")
+    parser.add_argument("--retry-after", type=int, default=1, help="Retry-After seconds of the 429 responses")
+    parser.add_argument("--reject-n", action="store_true", help="answer 400 to requests with n > 1")
+    parser.add_argument("--verbose", action="store_true")
+    args = parser.parse_args()
+    if args.record and not args.upstream:
+        parser.error("--record requires --upstream")
+
+    Handler.state = MockState(args)
+    server = Server((args.host, args.port), Handler)
+    sys.stderr.write("mock llm server listening on %s:%d\n" % (args.host, args.port))
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == "__main__":
+    main()
@@ -22,6 +22,8 @@
 // alloc wrapper detection
 #include "Passes/AllocWrapperDetect/Debug/DebugPass.h"
 
+#include "Utils/Tool/FunctionKeyIndex.h"
+
 // Command line parameters.
 static cl::list<string> InputFilenames(
         cl::Positional,
@@ -53,6 +55,12 @@ static cl::opt<bool> DebugMode(
         cl::init(false)
 );
 
+static cl::opt<unsigned> AnalysisThreads(
+        "analysis-threads",
+        cl::desc("worker threads used by parallel analysis, 0 means all hardware threads"),
+        cl::init(0)
+);
+
 // indirect-call结果保存路径
 static cl::opt<string> IcallOutputFilePath(
         "icall-output-file",
@@ -65,6 +73,13 @@ static cl::opt<string> WrapperOutputFilePath(
         cl::desc("Wrapper Analysis Output file path"),
         cl::init(""));
 
+// 分配/拷贝/释放API规范文件，默认文件不存在或路径为空时使用内置列表
+static cl::opt<string> APISpecFile(
+        "api-spec-file",
+        cl::desc("API specification file listing alloc/copy/dealloc/sensitive APIs. "
+                 "Built-in lists are used if the default file is missing or the path is empty"),
+        cl::init("../resources/api_spec.json"));
+
 cl::opt<string> PreAnalyzedPath(
         "pre-analyzed-path",
         cl::desc("pre analyzed wrapper path"),
@@ -97,7 +112,12 @@ int main(int argc, char** argv) {
         GlobalCtx.ModuleMaps[Module] = InputFilenames[i];
     }
 
+    if (!APISpecFile.empty() && !GlobalCtx.APIs.loadSpecFile(APISpecFile, !APISpecFile.getNumOccurrences()))
+        return 1;
+    GlobalCtx.APIs.resolve(GlobalCtx.Modules);
+
     debug_mode = DebugMode;
+    analysis_threads = AnalysisThreads;
     max_type_layer = MaxTypeLayer;
     CallGraphPass *CGPass;
     // 进行indirect-call分析
@@ -128,6 +148,10 @@ int main(int argc, char** argv) {
         exit(-1);
     }
 
+    // 对所有模块的函数建立一次索引，每行只需一次查找
+    FunctionKeyIndex funcIndex;
+    funcIndex.build(GlobalCtx.Modules);
+
     set<const Function*> preAnalyzed;
     while (getline(file, line)) {
         size_t pos1 = line.find('<');
@@ -138,15 +162,8 @@ int main(int argc, char** argv) {
             string fileName = line.substr(pos1 + 1, pos2 - pos1 - 1);
             unsigned lineNum = stoi(line.substr(pos2 + 1));
 
-            for (Module::const_iterator F = GlobalCtx.Modules[0].first->begin(),
-                    E = GlobalCtx.Modules[0].first->end(); F != E; ++F) {
-                const Function* fun = &*F;
-                if (removeFuncNumberSuffix(fun->getName().str()) == funcName &&
-                    fileName == fun->getSubprogram()->getFilename().str() &&
-                    lineNum == fun->getSubprogram()->getLine()) {
-                    preAnalyzed.insert(fun);
-                }
-            }
+            for (const Function* fun: funcIndex.lookup(funcName, fileName, lineNum))
+                preAnalyzed.insert(fun);
         }
     }
     file.close();
@@ -50,6 +50,12 @@ static cl::opt<bool> DebugMode(
         cl::init(false)
 );
 
+static cl::opt<unsigned> AnalysisThreads(
+        "analysis-threads",
+        cl::desc("worker threads used by parallel analysis, 0 means all hardware threads"),
+        cl::init(0)
+);
+
 // indirect-call结果保存路径
 static cl::opt<string> IcallOutputFilePath(
         "icall-output-file",
@@ -62,6 +68,12 @@ static cl::opt<string> WrapperOutputFilePath(
         cl::desc("Wrapper Analysis Output file path"),
         cl::init(""));
 
+// wrapper确认后立即追加写出的JSONL文件
+static cl::opt<string> WrapperStreamFilePath(
+        "wrapper-stream-file",
+        cl::desc("JSONL file each wrapper is appended to as soon as it is confirmed"),
+        cl::init(""));
+
 GlobalContext GlobalCtx;
 
 // 打印结果
@@ -69,7 +81,7 @@ void PrintResults(GlobalContext* GCtx) {
     int TotalTargets = 0;
     // 计算间接调用总共调用的target function数量
     for (auto IC : GCtx->IndirectCallInsts)
-        TotalTargets += GCtx->Callees[IC].size();
+        TotalTargets += GCtx->CG.callsiteCalleeIDs(GCtx->CG.getCallsiteID(IC)).size();
 
     int totalsize = 0;
     OP << "\n@@ Total number of final callees: " << totalsize << ".\n";
@@ -94,17 +106,18 @@ void PrintResults(GlobalContext* GCtx) {
     if (!IcallOutputFilePath.empty()) {
         ostream& output = (IcallOutputFilePath == "cout") ? cout : *(new ofstream(IcallOutputFilePath));
 
-        for (auto &curEle: GCtx->Callees) {
-            if (curEle.first->isIndirectCall()) {
-                totalsize += curEle.second.size();
-                FuncSet funcs = curEle.second;
+        // Callees在call graph冻结后已释放，按callsite编号顺序从CSR图读取
+        for (unsigned id = 0; id < GCtx->CG.getNumCallsites(); ++id) {
+            CallBase* CI = GCtx->CG.getCallsite(id);
+            if (CI->isIndirectCall()) {
+                totalsize += GCtx->CG.callsiteCalleeIDs(id).size();
 
-                auto* Scope = cast<DIScope>(curEle.first->getDebugLoc().getScope());
+                auto* Scope = cast<DIScope>(CI->getDebugLoc().getScope());
                 string callsiteFile = Scope->getFilename().str();
-                int line = curEle.first->getDebugLoc().getLine();
-                int col = curEle.first->getDebugLoc().getCol();
+                int line = CI->getDebugLoc().getLine();
+                int col = CI->getDebugLoc().getCol();
                 string content = callsiteFile + ":" + itostr(line) + ":" + itostr(col) + "|";
-                for (Function* func: funcs)
+                for (Function* func: GCtx->CG.callees(CI))
                     content += (func->getName().str() + ",");
                 content = content.substr(0, content.size() - 1);
                 content += "\n";
@@ -158,7 +171,10 @@ int main(int argc, char** argv) {
     }
 
     debug_mode = DebugMode;
+    analysis_threads = AnalysisThreads;
     max_type_layer = MaxTypeLayer;
+    if (!WrapperStreamFilePath.empty() && !GlobalCtx.WrapperStream.open(WrapperStreamFilePath))
+        return 1;
     auto start = high_resolution_clock::now();
     CallGraphPass* CGPass;
     // 进行indirect-call分析
@@ -67,6 +67,12 @@ static cl::opt<bool> DebugMode(
         cl::init(false)
 );
 
+static cl::opt<unsigned> AnalysisThreads(
+        "analysis-threads",
+        cl::desc("worker threads used by parallel analysis, 0 means all hardware threads"),
+        cl::init(0)
+);
+
 // indirect-call结果保存路径
 static cl::opt<string> IcallOutputFilePath(
         "icall-output-file",
@@ -79,6 +85,19 @@ static cl::opt<string> WrapperOutputFilePath(
         cl::desc("Wrapper Analysis Output file path"),
         cl::init(""));
 
+// wrapper确认后立即追加写出的JSONL文件
+static cl::opt<string> WrapperStreamFilePath(
+        "wrapper-stream-file",
+        cl::desc("JSONL file each wrapper is appended to as soon as it is confirmed"),
+        cl::init(""));
+
+// 分配/拷贝/释放API规范文件，默认文件不存在或路径为空时使用内置列表
+static cl::opt<string> APISpecFile(
+        "api-spec-file",
+        cl::desc("API specification file listing alloc/copy/dealloc/sensitive APIs. "
+                 "Built-in lists are used if the default file is missing or the path is empty"),
+        cl::init("../resources/api_spec.json"));
+
 // source code file
 cl::opt<string> SouceCodeInfoFile(
         "source-info-file",
@@ -129,6 +148,66 @@ cl::opt<string> WrapperInfoFile(
         cl::init("")
         );
 
+// LLM响应缓存目录，为空时不缓存
+cl::opt<string> LLMCacheDir(
+        "llm-cache-dir",
+        cl::desc("directory of the persistent LLM response cache, empty means no cache"),
+        cl::init("")
+        );
+
+// 同时进行的LLM请求上限，所有投票共享
+cl::opt<unsigned> LLMConcurrency(
+        "llm-concurrency",
+        cl::desc("maximum number of concurrent LLM requests"),
+        cl::init(16)
+        );
+
+// 通过n参数在一次请求中获取全部投票样本
+cl::opt<bool> LLMMultiSample(
+        "llm-multi-sample",
+        cl::desc("request all votes of a function in one request through the n parameter"),
+        cl::init(false)
+        );
+
+// LLM请求预算，0表示不限制
+cl::opt<double> LLMRequestsPerSec(
+        "llm-rps",
+        cl::desc("maximum LLM requests per second, 0 means unlimited"),
+        cl::init(0)
+        );
+
+cl::opt<double> LLMTokensPerMin(
+        "llm-tpm",
+        cl::desc("maximum LLM tokens (prompt + completion) per minute, 0 means unlimited"),
+        cl::init(0)
+        );
+
+cl::opt<double> LLMBackoffMs(
+        "llm-backoff-ms",
+        cl::desc("base delay of the exponential backoff between retries of a failed LLM request"),
+        cl::init(500)
+        );
+
+// 规范化后prompt相同的函数共享一次分类
+cl::opt<bool> LLMDedupPrompts(
+        "llm-dedup-prompts",
+        cl::desc("classify functions whose normalized prompts are identical with a single LLM query"),
+        cl::init(true)
+        );
+
+// -log-dir为目录时LLM日志写入<dir>/llm_log.jsonl
+cl::opt<unsigned> LLMLogMaxMB(
+        "llm-log-max-mb",
+        cl::desc("rotate the LLM log after it grows beyond this size in MB, 0 means never"),
+        cl::init(0)
+        );
+
+cl::opt<bool> LLMLogZstd(
+        "llm-log-zstd",
+        cl::desc("compress the LLM log with zstd"),
+        cl::init(false)
+        );
+
 GlobalContext GlobalCtx;
 
 
@@ -137,7 +216,7 @@ void PrintResults(GlobalContext* GCtx) {
     int TotalTargets = 0;
     // 计算间接调用总共调用的target function数量
     for (auto IC : GCtx->IndirectCallInsts)
-        TotalTargets += GCtx->Callees[IC].size();
+        TotalTargets += GCtx->CG.callsiteCalleeIDs(GCtx->CG.getCallsiteID(IC)).size();
 
     int totalsize = 0;
     OP << "\n@@ Total number of final callees: " << totalsize << ".\n";
@@ -162,17 +241,18 @@ void PrintResults(GlobalContext* GCtx) {
     if (!IcallOutputFilePath.empty()) {
         ostream& output = (IcallOutputFilePath == "cout") ? cout : *(new ofstream(IcallOutputFilePath));
 
-        for (auto &curEle: GCtx->Callees) {
-            if (curEle.first->isIndirectCall()) {
-                totalsize += curEle.second.size();
-                FuncSet funcs = curEle.second;
+        // Callees在call graph冻结后已释放，按callsite编号顺序从CSR图读取
+        for (unsigned id = 0; id < GCtx->CG.getNumCallsites(); ++id) {
+            CallBase* CI = GCtx->CG.getCallsite(id);
+            if (CI->isIndirectCall()) {
+                totalsize += GCtx->CG.callsiteCalleeIDs(id).size();
 
-                auto* Scope = cast<DIScope>(curEle.first->getDebugLoc().getScope());
+                auto* Scope = cast<DIScope>(CI->getDebugLoc().getScope());
                 string callsiteFile = Scope->getFilename().str();
-                int line = curEle.first->getDebugLoc().getLine();
-                int col = curEle.first->getDebugLoc().getCol();
+                int line = CI->getDebugLoc().getLine();
+                int col = CI->getDebugLoc().getCol();
                 string content = callsiteFile + ":" + itostr(line) + ":" + itostr(col) + "|";
-                for (Function* func: funcs)
+                for (Function* func: GCtx->CG.callees(CI))
                     content += (func->getName().str() + ",");
                 content = content.substr(0, content.size() - 1);
                 content += "\n";
@@ -225,6 +305,10 @@ int main(int argc, char** argv) {
         GlobalCtx.ModuleMaps[Module] = InputFilenames[i];
     }
 
+    if (!APISpecFile.empty() && !GlobalCtx.APIs.loadSpecFile(APISpecFile, !APISpecFile.getNumOccurrences()))
+        return 1;
+    GlobalCtx.APIs.resolve(GlobalCtx.Modules);
+
     if (SouceCodeInfoFile.empty()) {
         OP << "please input valid source code information file\n";
         return 0;
@@ -249,10 +333,28 @@ int main(int argc, char** argv) {
     unordered_map<string, FunctionInfo> sourceInfos = parseSourceFileInfo(SouceCodeInfoFile);
     OP << "parse source info done\n";
 
-    auto llmAnalyzer = new LLMAnalyzer(Address, Temperature, RetryTime, VoteTime);
+    auto llmAnalyzer = new LLMAnalyzer(Address, Temperature, RetryTime, VoteTime, "", LLMConcurrency);
+    llmAnalyzer->multiSample = LLMMultiSample;
+    llmAnalyzer->limiter.configure(LLMRequestsPerSec, LLMTokensPerMin, LLMBackoffMs);
+    if (!llmAnalyzer->fetchModel())
+        return 1;
+    LLMResponseCache llmCache;
+    if (!LLMCacheDir.empty()) {
+        if (!llmCache.open(LLMCacheDir))
+            return 1;
+        llmAnalyzer->cache = &llmCache;
+    }
+
+    LLMLogSink llmLog;
+    if (!LogDir.empty() && LogDir != "cout" &&
+        !llmLog.open(LogDir, LLMLogZstd, (uint64_t) LLMLogMaxMB * 1024 * 1024))
+        return 1;
 
     debug_mode = DebugMode;
+    analysis_threads = AnalysisThreads;
     max_type_layer = MaxTypeLayer;
+    if (!WrapperStreamFilePath.empty() && !GlobalCtx.WrapperStream.open(WrapperStreamFilePath))
+        return 1;
 
     auto start = high_resolution_clock::now();
     CallGraphPass* CGPass;
@@ -279,15 +381,23 @@ int main(int argc, char** argv) {
 
     start = high_resolution_clock::now();
     HAWDPass* WDPass;
-    if (WrapperAnalysisType == 1)
-        WDPass = new IntraAWDPass(&GlobalCtx, sourceInfos, jsonData["summarizing"], llmAnalyzer,
-                                  jsonData["intra_sys"], jsonData["intra_user"], LogDir);
+    if (WrapperAnalysisType == 1) {
+        IntraAWDPass* intraPass = new IntraAWDPass(&GlobalCtx, sourceInfos, jsonData["summarizing"], llmAnalyzer,
+                                                   jsonData["intra_sys"], jsonData["intra_user"], LogDir, LLMConcurrency);
+        intraPass->dedupPrompts = LLMDedupPrompts;
+        if (llmLog.isOpen())
+            intraPass->logSink = &llmLog;
+        WDPass = intraPass;
+    }
     else {
         cout << "unimplemnted wrapper analysis type, break\n";
         return 0;
     }
 
     WDPass->run(GlobalCtx.Modules);
+    // cancelled votes still hold http handles
+    llmAnalyzer->waitForVotes();
+    llmLog.close();
     if (!WrapperInfoFile.empty())
         dumpAllocationWrapperInfo(WDPass->function2AllocCalls, &GlobalCtx, WrapperInfoFile);
 
@@ -298,7 +408,23 @@ int main(int argc, char** argv) {
 
     OP << "LLM Spend: " << llmAnalyzer->totalLLMTime << ", input tokens: " <<
         llmAnalyzer->totalInputTokenNum << ", output tokens: " << llmAnalyzer->totalOutputTokenNum <<
-        ", query num: " << llmAnalyzer->totalQueryNum << "\n";
+        ", query num: " << llmAnalyzer->totalQueryNum << ", skipped votes: " << llmAnalyzer->totalSkippedVoteNum <<
+        ", multi-sample queries: " << llmAnalyzer->totalMultiSampleQueryNum << "\n";
+    HttpStats httpStats = getHttpStats();
+    OP << "HTTP requests: " << httpStats.requestNum << ", new connections: " << httpStats.newConnectionNum <<
+        ", connect ms: " << (long) httpStats.connectMs << ", total ms: " << (long) httpStats.totalMs << "\n";
+    LLMExecutor* executor = llmAnalyzer->executor.get();
+    OP << "LLM executor workers: " << executor->getConcurrency() << ", jobs: " << executor->totalJobNum <<
+        ", max queue depth: " << executor->maxQueueDepth << ", avg queue wait ms: " <<
+        (long) (executor->totalJobNum ? executor->totalQueueWaitMs / executor->totalJobNum : 0) << "\n";
+    LLMRateLimiter& limiter = llmAnalyzer->limiter;
+    OP << "LLM throttled ms: " << (long) limiter.getThrottledMs() << " (rate limit: " << (long) limiter.rateThrottledMs <<
+        ", retry-after: " << (long) limiter.retryAfterMs << " over " << limiter.retryAfterNum << " responses, backoff: " <<
+        (long) limiter.backoffMs << ")\n";
+    if (llmLog.recordNum)
+        OP << "LLM log records: " << llmLog.recordNum << ", max queued: " << llmLog.maxQueueDepth << "\n";
+    if (llmAnalyzer->cache)
+        OP << "LLM cache hits: " << llmCache.hitNum << ", misses: " << llmCache.missNum << "\n";
 
     cout << "| " << duration.count() << " | " << llmAnalyzer->totalLLMTime << " | " << (duration.count() - llmAnalyzer->totalLLMTime) <<
        " | " << llmAnalyzer->totalQueryNum << " | "
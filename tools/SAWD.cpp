@@ -45,11 +45,12 @@ static cl::opt<int> ICallAnalysisType(
         cl::desc("select which call analysis to use: 1 --> FLTA, 2 --> MLTA, 3 --> Data Flow Enhanced MLTA, 4 --> Kelp, 5 --> Cpp Callgraph Analysis"),
         cl::NotHidden, cl::init(4));
 
-// wrapper analysis type
-static cl::opt<int> WrapperAnalysisType(
+// wrapper analysis type, 可以逗号分隔指定多个，在同一call graph上依次运行
+static cl::list<int> WrapperAnalysisTypes(
         "wrapper-analysis-type",
-        cl::desc("select which wrapper analysis to use: 1 --> AWDPass, 2 --> BUAWDPass, 3 --> HAWDPass"),
-        cl::NotHidden, cl::init(1)
+        cl::desc("select which wrapper analysis to use: 1 --> AWDPass, 2 --> BUAWDPass, 3 --> HAWDPass, 4 --> EHAWDPass. "
+                 "A comma separated list runs every selected pass on the same call graph, default 1"),
+        cl::NotHidden, cl::CommaSeparated
 );
 
 // max_type_layer
@@ -64,6 +65,12 @@ static cl::opt<bool> DebugMode(
         cl::init(false)
 );
 
+static cl::opt<unsigned> AnalysisThreads(
+        "analysis-threads",
+        cl::desc("worker threads used by parallel analysis, 0 means all hardware threads"),
+        cl::init(0)
+);
+
 // indirect-call结果保存路径
 static cl::opt<string> IcallOutputFilePath(
         "icall-output-file",
@@ -76,14 +83,74 @@ static cl::opt<string> WrapperOutputFilePath(
         cl::desc("Wrapper Analysis Output file path"),
         cl::init(""));
 
+// wrapper确认后立即追加写出的JSONL文件
+static cl::opt<string> WrapperStreamFilePath(
+        "wrapper-stream-file",
+        cl::desc("JSONL file each wrapper is appended to as soon as it is confirmed"),
+        cl::init(""));
+
+// 分配/拷贝/释放API规范文件，默认文件不存在或路径为空时使用内置列表
+static cl::opt<string> APISpecFile(
+        "api-spec-file",
+        cl::desc("API specification file listing alloc/copy/dealloc/sensitive APIs. "
+                 "Built-in lists are used if the default file is missing or the path is empty"),
+        cl::init("../resources/api_spec.json"));
+
+// 多个wrapper pass的对比表保存路径
+static cl::opt<string> WrapperCompareFilePath(
+        "wrapper-compare-file",
+        cl::desc("Comparison table (pass, wrapper count, time) output file path when several wrapper analysis types are given"),
+        cl::init(""));
+
 GlobalContext GlobalCtx;
 
-// 打印结果
+// 单个wrapper pass的运行结果
+struct WrapperRunResult {
+    string name;
+    size_t wrapperNum;
+    long long ms;
+};
+
+static const char* getWrapperPassName(int type) {
+    switch (type) {
+        case 1: return "AWD";
+        case 2: return "BUAWD";
+        case 3: return "HAWD";
+        case 4: return "EHAWD";
+        default: return nullptr;
+    }
+}
+
+static AWDPass* createWrapperPass(int type) {
+    if (type == 1)
+        return new AWDPass(&GlobalCtx);
+    else if (type == 2)
+        return new BUAWDPass(&GlobalCtx);
+    else if (type == 3)
+        return new HAWDPass(&GlobalCtx);
+    else if (type == 4)
+        return new EHAWDPass(&GlobalCtx);
+    return nullptr;
+}
+
+// 只运行一个pass时直接使用给定路径，多个pass时在扩展名前插入pass名，如out.txt -> out.HAWD.txt
+static string getWrapperOutputPath(const string& name, bool multiple) {
+    if (!multiple || WrapperOutputFilePath == "cout")
+        return WrapperOutputFilePath;
+    string path = WrapperOutputFilePath;
+    size_t slash = path.find_last_of('/');
+    size_t dot = path.find_last_of('.');
+    if (dot == string::npos || (slash != string::npos && dot < slash))
+        return path + "." + name;
+    return path.substr(0, dot) + "." + name + path.substr(dot);
+}
+
+// 打印call graph统计与indirect-call结果
 void PrintResults(GlobalContext* GCtx) {
     int TotalTargets = 0;
     // 计算间接调用总共调用的target function数量
     for (auto IC : GCtx->IndirectCallInsts)
-        TotalTargets += GCtx->Callees[IC].size();
+        TotalTargets += GCtx->CG.callsiteCalleeIDs(GCtx->CG.getCallsiteID(IC)).size();
 
     int totalsize = 0;
     OP << "\n@@ Total number of final callees: " << totalsize << ".\n";
@@ -102,23 +169,22 @@ void PrintResults(GlobalContext* GCtx) {
     OP << "# Number of simple indirect calls: \t\t\t" << GCtx->NumSimpleIndCalls << "\n";
     OP << "# Number of confined functions: \t\t\t" << GCtx->NumConfinedFuncs << "\n";
 
-    OP << "# Number of customized alloc Function: \t\t\t" << GCtx->AllocWrapperKeys.size() << "\n";
-
     // 根据OutputFilePath决定输出方式
     if (!IcallOutputFilePath.empty()) {
         ostream& output = (IcallOutputFilePath == "cout") ? cout : *(new ofstream(IcallOutputFilePath));
 
-        for (auto &curEle: GCtx->Callees) {
-            if (curEle.first->isIndirectCall()) {
-                totalsize += curEle.second.size();
-                FuncSet funcs = curEle.second;
+        // Callees在call graph冻结后已释放，按callsite编号顺序从CSR图读取
+        for (unsigned id = 0; id < GCtx->CG.getNumCallsites(); ++id) {
+            CallBase* CI = GCtx->CG.getCallsite(id);
+            if (CI->isIndirectCall()) {
+                totalsize += GCtx->CG.callsiteCalleeIDs(id).size();
 
-                auto* Scope = cast<DIScope>(curEle.first->getDebugLoc().getScope());
+                auto* Scope = cast<DIScope>(CI->getDebugLoc().getScope());
                 string callsiteFile = Scope->getFilename().str();
-                int line = curEle.first->getDebugLoc().getLine();
-                int col = curEle.first->getDebugLoc().getCol();
+                int line = CI->getDebugLoc().getLine();
+                int col = CI->getDebugLoc().getCol();
                 string content = callsiteFile + ":" + itostr(line) + ":" + itostr(col) + "|";
-                for (Function* func: funcs)
+                for (Function* func: GCtx->CG.callees(CI))
                     content += (func->getName().str() + ",");
                 content = content.substr(0, content.size() - 1);
                 content += "\n";
@@ -132,18 +198,39 @@ void PrintResults(GlobalContext* GCtx) {
         }
     }
 
+}
+
+// 打印一个wrapper pass的结果
+void PrintWrapperResults(GlobalContext* GCtx, const string& name, bool multiple) {
+    OP << "# Number of customized alloc Function: \t\t\t" << GCtx->AllocWrapperKeys.size() << "\n";
+
     if (!WrapperOutputFilePath.empty()) {
-        ostream& output = (WrapperOutputFilePath == "cout") ? cout : *(new ofstream(WrapperOutputFilePath));
+        string path = getWrapperOutputPath(name, multiple);
+        ostream& output = (path == "cout") ? cout : *(new ofstream(path));
 
+        if (multiple && path == "cout")
+            output << "## " << name << "\n";
         for (const string& wrapperKey: GCtx->AllocWrapperKeys)
             output << wrapperKey << "\n";
 
-        if (WrapperOutputFilePath != "cout") {
+        if (path != "cout") {
             static_cast<ofstream &>(output).close();
             delete &output;
         }
     }
+}
+
+// 打印多个wrapper pass的对比表
+void PrintWrapperComparison(const vector<WrapperRunResult>& results) {
+    string table = "pass\twrappers\ttime(ms)\n";
+    for (const WrapperRunResult& result: results)
+        table += result.name + "\t" + utostr(result.wrapperNum) + "\t" + itostr(result.ms) + "\n";
 
+    OP << "############## Wrapper Analysis Comparison ##############\n" << table;
+    if (!WrapperCompareFilePath.empty()) {
+        ofstream output(WrapperCompareFilePath);
+        output << table;
+    }
 }
 
 
@@ -171,8 +258,15 @@ int main(int argc, char** argv) {
         GlobalCtx.ModuleMaps[Module] = InputFilenames[i];
     }
 
+    if (!APISpecFile.empty() && !GlobalCtx.APIs.loadSpecFile(APISpecFile, !APISpecFile.getNumOccurrences()))
+        return 1;
+    GlobalCtx.APIs.resolve(GlobalCtx.Modules);
+
     debug_mode = DebugMode;
+    analysis_threads = AnalysisThreads;
     max_type_layer = MaxTypeLayer;
+    if (!WrapperStreamFilePath.empty() && !GlobalCtx.WrapperStream.open(WrapperStreamFilePath))
+        return 1;
     auto start = high_resolution_clock::now();
     CallGraphPass* CGPass;
     // 进行indirect-call分析
@@ -196,27 +290,37 @@ int main(int argc, char** argv) {
     seconds duration = duration_cast<seconds>(end - start);
     OP << "indirect call analysis spent: " << duration.count() << " seconds\n";
 
-    start = high_resolution_clock::now();
-    AWDPass* WDPass;
-    if (WrapperAnalysisType == 1)
-        WDPass = new AWDPass(&GlobalCtx);
-    else if (WrapperAnalysisType == 2)
-        WDPass = new BUAWDPass(&GlobalCtx);
-    else if (WrapperAnalysisType == 3)
-        WDPass = new HAWDPass(&GlobalCtx);
-    else if (WrapperAnalysisType == 4)
-        WDPass = new EHAWDPass(&GlobalCtx);
-    else {
-        cout << "unimplemnted wrapper analysis type, break\n";
-        return 0;
+    vector<int> wrapperTypes(WrapperAnalysisTypes.begin(), WrapperAnalysisTypes.end());
+    if (wrapperTypes.empty())
+        wrapperTypes.push_back(1);
+    for (int type: wrapperTypes) {
+        if (!getWrapperPassName(type)) {
+            cout << "unimplemnted wrapper analysis type, break\n";
+            return 0;
+        }
     }
-    WDPass->run(GlobalCtx.Modules);
-    delete WDPass;
-    end = high_resolution_clock::now();
-    duration = duration_cast<seconds>(end - start);
-    OP << "alloc wrapper analysis spent: " << duration.count() << " seconds\n";
-
-    // 打印分析结果
     PrintResults(&GlobalCtx);
+
+    // 各wrapper pass共享call graph、IR事实表与值流缓存，每次运行前清空上一个pass的结果
+    bool multiple = wrapperTypes.size() > 1;
+    vector<WrapperRunResult> results;
+    for (int type: wrapperTypes) {
+        string name = getWrapperPassName(type);
+        GlobalCtx.clearWrapperResults();
+        start = high_resolution_clock::now();
+        AWDPass* WDPass = createWrapperPass(type);
+        WDPass->run(GlobalCtx.Modules);
+        delete WDPass;
+        end = high_resolution_clock::now();
+        milliseconds ms = duration_cast<milliseconds>(end - start);
+        OP << name << " alloc wrapper analysis spent: " << duration_cast<seconds>(ms).count() << " seconds\n";
+
+        // 打印分析结果
+        PrintWrapperResults(&GlobalCtx, name, multiple);
+        results.push_back({name, GlobalCtx.AllocWrapperKeys.size(), (long long) ms.count()});
+    }
+
+    if (multiple)
+        PrintWrapperComparison(results);
     return 0;
 }
\ No newline at end of file